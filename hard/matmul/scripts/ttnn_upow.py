@@ -1,5 +1,6 @@
 #!/usr/bin/env python3
 import argparse
+import hashlib
 import json
 import os
 import sys
@@ -9,11 +10,23 @@ from pathlib import Path
 import numpy as np
 from blake3 import blake3
 
+sys.path.insert(0, str(Path(__file__).resolve().parent))
+try:
+    import upow_expand  # built by `make pyext`
+except ImportError as exc:
+    upow_expand = None
+    print(
+        f"WARNING: upow_expand extension unavailable ({exc}); expanding A/B in pure Python. "
+        "Build it with `make -C hard/matmul pyext`.",
+        file=sys.stderr,
+    )
+
 
 K_DIM = 50240
 M_DIM = 16
 N_DIM = 16
 SEED_SIZE = 240
+NONCE_OFFSET = 232
 TILE = 32
 
 
@@ -40,6 +53,32 @@ def pad_to(value: int, multiple: int) -> int:
     return ((value + multiple - 1) // multiple) * multiple
 
 
+_PADDED = None
+
+
+def padded_buffers():
+    """Zeroed, tile-padded A/B buffers, allocated once and reused per seed."""
+    global _PADDED
+    if _PADDED is None:
+        _PADDED = (
+            np.zeros((pad_to(M_DIM, TILE), K_DIM), dtype=np.uint8),
+            np.zeros((K_DIM, pad_to(N_DIM, TILE)), dtype=np.int8),
+        )
+    return _PADDED
+
+
+def expand_padded(seed: bytes, threads: int = 0):
+    """Fills the reused padded buffers with A||B = blake3(seed).digest(2*M*K)."""
+    a_pad, b_pad = padded_buffers()
+    if upow_expand is not None:
+        upow_expand.expand_into(seed, a_pad, b_pad, threads)
+    else:
+        ab = blake3(seed).digest(2 * M_DIM * K_DIM)
+        a_pad[:M_DIM, :K_DIM] = np.frombuffer(ab, dtype=np.uint8, count=M_DIM * K_DIM).reshape(M_DIM, K_DIM)
+        b_pad[:K_DIM, :N_DIM] = np.frombuffer(ab, dtype=np.int8, offset=M_DIM * K_DIM).reshape(K_DIM, N_DIM)
+    return a_pad, b_pad
+
+
 def get_ttnn_dtype(ttnn, names) -> object:
     for name in names:
         dtype = getattr(ttnn, name, None)
@@ -100,53 +139,89 @@ def close_device(ttnn, device):
         device.close()
 
 
-def run_matmul_ttnn(a_pad: np.ndarray, b_pad: np.ndarray, device_id: int):
-    try:
-        import torch
-        ttnn = import_ttnn()
-    except Exception as exc:
-        raise RuntimeError(f"Failed to import ttnn/torch: {exc}") from exc
-
-    a_dtype = get_ttnn_dtype(ttnn, ["uint8", "uint8_t"])
-    b_dtype = get_ttnn_dtype(ttnn, ["int8", "int8_t"])
-    out_dtype = get_ttnn_dtype(ttnn, ["int32", "int32_t"])
-    if b_dtype is None or out_dtype is None:
-        raise RuntimeError("TTNN int8/int32 dtypes are required.")
-
-    layout = getattr(ttnn, "TILE_LAYOUT", None)
-    if layout is None:
-        layout = getattr(ttnn, "ROW_MAJOR_LAYOUT", None)
-    if layout is None:
-        raise RuntimeError("TTNN layout constant not found.")
-
-    device = open_device(ttnn, device_id)
-    used_signed_a = False
-    try:
+class TtnnMatmul:
+    """Opens the device once and runs one padded A x B per seed on it."""
+
+    def __init__(self, device_id: int):
+        try:
+            import torch
+            ttnn = import_ttnn()
+        except Exception as exc:
+            raise RuntimeError(f"Failed to import ttnn/torch: {exc}") from exc
+
+        self.torch = torch
+        self.ttnn = ttnn
+        self.a_dtype = get_ttnn_dtype(ttnn, ["uint8", "uint8_t"])
+        self.b_dtype = get_ttnn_dtype(ttnn, ["int8", "int8_t"])
+        self.out_dtype = get_ttnn_dtype(ttnn, ["int32", "int32_t"])
+        if self.b_dtype is None or self.out_dtype is None:
+            raise RuntimeError("TTNN int8/int32 dtypes are required.")
+        # Without a uint8 dtype A is shifted to int8 and C corrected on the host.
+        self.used_signed_a = self.a_dtype is None
+
+        layout = getattr(ttnn, "TILE_LAYOUT", None)
+        if layout is None:
+            layout = getattr(ttnn, "ROW_MAJOR_LAYOUT", None)
+        if layout is None:
+            raise RuntimeError("TTNN layout constant not found.")
+        self.layout = layout
+        self.device = open_device(ttnn, device_id)
+
+    def close(self) -> None:
+        if self.device is not None:
+            close_device(self.ttnn, self.device)
+            self.device = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc) -> None:
+        self.close()
+
+    def run(self, a_pad: np.ndarray, b_pad: np.ndarray) -> np.ndarray:
+        torch, ttnn = self.torch, self.ttnn
         a_torch = torch.from_numpy(a_pad)
         b_torch = torch.from_numpy(b_pad)
+        a_dtype = self.a_dtype
+        if self.used_signed_a:
+            a_torch = (a_torch.to(torch.int16) - 128).to(torch.int8)
+            a_dtype = self.b_dtype
 
-        if a_dtype is None:
-            a_signed = a_torch.to(torch.int16) - 128
-            a_torch = a_signed.to(torch.int8)
-            a_dtype = b_dtype
-            used_signed_a = True
-
-        a_tt = ttnn.from_torch(a_torch, device=device, dtype=a_dtype, layout=layout)
-        b_tt = ttnn.from_torch(b_torch, device=device, dtype=b_dtype, layout=layout)
+        a_tt = ttnn.from_torch(a_torch, device=self.device, dtype=a_dtype, layout=self.layout)
+        b_tt = ttnn.from_torch(b_torch, device=self.device, dtype=self.b_dtype, layout=self.layout)
 
         try:
-            c_tt = ttnn.matmul(a_tt, b_tt, dtype=out_dtype)
+            c_tt = ttnn.matmul(a_tt, b_tt, dtype=self.out_dtype)
         except TypeError:
-            c_tt = ttnn.matmul(a_tt, b_tt, output_dtype=out_dtype)
+            c_tt = ttnn.matmul(a_tt, b_tt, output_dtype=self.out_dtype)
 
         if hasattr(ttnn, "synchronize"):
-            ttnn.synchronize(device)
+            ttnn.synchronize(self.device)
+
+        c_np = ttnn.to_torch(c_tt)[:M_DIM, :N_DIM].cpu().numpy().astype(np.int32, copy=False)
+        if self.used_signed_a:
+            b_sum = b_pad[:K_DIM, :N_DIM].astype(np.int32).sum(axis=0)
+            c_np = c_np + (128 * b_sum)[None, :]
+        return c_np
+
+
+def seed_with_nonce(seed: bytes, nonce: int) -> bytes:
+    return seed[:NONCE_OFFSET] + (nonce % (1 << 64)).to_bytes(SEED_SIZE - NONCE_OFFSET, "little")
+
 
-        c_torch = ttnn.to_torch(c_tt)
-    finally:
-        close_device(ttnn, device)
+def leading_zero_bits(digest: bytes) -> int:
+    bits = 0
+    for b in digest:
+        if b:
+            return bits + 8 - b.bit_length()
+        bits += 8
+    return bits
 
-    return c_torch, used_signed_a
+
+def solution_bits(solution: bytes, hash_algo: str) -> int:
+    if hash_algo == "sha256":
+        return leading_zero_bits(hashlib.sha256(solution).digest())
+    return leading_zero_bits(blake3(solution).digest())
 
 
 def main() -> None:
@@ -156,41 +231,64 @@ def main() -> None:
     parser.add_argument("--output")
     parser.add_argument("--print-solution", action="store_true")
     parser.add_argument("--device", type=int, default=int(os.environ.get("TT_DEVICE_ID", "0")))
+    parser.add_argument("--expand-threads", type=int, default=int(os.environ.get("EXPAND_THREADS", "0")))
+    # Mining: walk --nonces nonces (0 = until --target-bits is met) from
+    # --nonce-start in this one process, reusing the device and buffers.
+    parser.add_argument("--nonces", type=int, default=1)
+    parser.add_argument("--nonce-start", type=int)
+    parser.add_argument("--target-bits", type=int, default=0)
+    parser.add_argument("--print-every", type=int, default=1)
+    parser.add_argument("--hash-algo", choices=["blake3", "sha256"], default=os.environ.get("HASH_ALGO", "blake3"))
     args = parser.parse_args()
-
-    seed = load_seed(args.seed_hex, args.seed_bin)
-    ab = blake3(seed).digest(2 * M_DIM * K_DIM)
-    a_bytes = ab[: M_DIM * K_DIM]
-    b_bytes = ab[M_DIM * K_DIM :]
-
-    a_np = np.frombuffer(a_bytes, dtype=np.uint8).reshape(M_DIM, K_DIM)
-    b_np = np.frombuffer(b_bytes, dtype=np.int8).reshape(K_DIM, N_DIM)
-
-    m_pad = pad_to(M_DIM, TILE)
-    n_pad = pad_to(N_DIM, TILE)
-    a_pad = np.zeros((m_pad, K_DIM), dtype=np.uint8)
-    b_pad = np.zeros((K_DIM, n_pad), dtype=np.int8)
-    a_pad[:M_DIM, :K_DIM] = a_np
-    b_pad[:K_DIM, :N_DIM] = b_np
-
+    if args.nonces == 0 and args.target_bits == 0:
+        die("--nonces 0 needs --target-bits.")
+    print_every = max(args.print_every, 1)
+
+    base_seed = load_seed(args.seed_hex, args.seed_bin)
+    nonce = args.nonce_start
+    if nonce is None:
+        nonce = int.from_bytes(base_seed[NONCE_OFFSET:], "little")
+
+    best_bits = -1
+    best_solution = None
+    attempts = 0
+    found = False
+    matmul_ms = 0.0
     start = time.time()
-    c_torch, used_signed_a = run_matmul_ttnn(a_pad, b_pad, args.device)
-    elapsed_ms = (time.time() - start) * 1000.0
-
-    c_np = c_torch[:M_DIM, :N_DIM].cpu().numpy().astype(np.int32, copy=False)
-    if used_signed_a:
-        b_sum = b_np.astype(np.int32).sum(axis=0)
-        c_np = c_np + (128 * b_sum)[None, :]
+    with TtnnMatmul(args.device) as mm:
+        while args.nonces == 0 or attempts < args.nonces:
+            seed = seed_with_nonce(base_seed, nonce)
+            a_pad, b_pad = expand_padded(seed, args.expand_threads)
+            t0 = time.time()
+            c_np = mm.run(a_pad, b_pad)
+            matmul_ms += (time.time() - t0) * 1000.0
+            solution = seed + c_np.astype("<i4", copy=False).tobytes()
+            attempts += 1
+
+            bits = solution_bits(solution, args.hash_algo)
+            if bits > best_bits:
+                best_bits, best_solution = bits, solution
+            elapsed = time.time() - start
+            rate = attempts / elapsed if elapsed > 0 else 0.0
+            if args.nonces != 1 and attempts % print_every == 0:
+                print(f"hashes={attempts} rate_h/s={rate:.3f} best={best_bits} bits={bits} nonce={nonce}", flush=True)
+            if args.target_bits and bits >= args.target_bits:
+                found = True
+                best_solution = solution
+                print(f"FOUND! nonce={nonce} bits={bits} rate_avg_h/s={rate:.3f}", flush=True)
+                break
+            nonce += 1
 
-    solution = seed + c_np.astype("<i4", copy=False).tobytes()
     if args.output:
         Path(args.output).parent.mkdir(parents=True, exist_ok=True)
-        Path(args.output).write_bytes(solution)
+        Path(args.output).write_bytes(best_solution)
 
-    metrics = {"mode": "ttnn_upow", "elapsed_ms": round(elapsed_ms, 6)}
+    metrics = {"mode": "ttnn_upow", "elapsed_ms": round(matmul_ms, 6)}
+    if args.nonces != 1:
+        metrics.update(hashes=attempts, best=best_bits, found=found, expander="native" if upow_expand else "python")
     print(json.dumps(metrics))
     if args.print_solution:
-        print(f"solution_hex={solution.hex()}")
+        print(f"solution_hex={best_solution.hex()}")
 
 
 if __name__ == "__main__":
@@ -0,0 +1,91 @@
+#include "expand.h"
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "blake3.h"
+
+namespace upow {
+namespace {
+
+// Smallest range worth a thread; ranges start on XOF block boundaries so
+// no block is compressed twice.
+constexpr size_t kMinChunk = size_t(64) << 10;
+constexpr size_t kXofBlock = BLAKE3_BLOCK_LEN;
+constexpr size_t kStage = 4096;
+static_assert(kStage % kNDim == 0, "staged B rows never straddle a refill");
+
+struct Dest {
+    uint8_t *a;
+    size_t a_stride;
+    int8_t *b;
+    size_t b_stride;
+};
+
+// Writes XOF bytes [lo, hi) to their place in A.
+void fill_a(const blake3_hasher &h, const Dest &d, size_t lo, size_t hi) {
+    while (lo < hi) {
+        size_t row = lo / kKDim;
+        size_t col = lo % kKDim;
+        size_t n = kKDim - col < hi - lo ? kKDim - col : hi - lo;
+        if (d.a_stride == kKDim) n = hi - lo;  // rows are contiguous
+        blake3_hasher_finalize_seek(&h, lo, d.a + row * d.a_stride + col, n);
+        lo += n;
+    }
+}
+
+// Writes XOF bytes [lo, hi) (offsets past kASize) to their place in B.
+void fill_b(const blake3_hasher &h, const Dest &d, size_t lo, size_t hi) {
+    if (d.b_stride == kNDim) {
+        blake3_hasher_finalize_seek(&h, lo, reinterpret_cast<uint8_t *>(d.b) + (lo - kASize), hi - lo);
+        return;
+    }
+    uint8_t stage[kStage];
+    while (lo < hi) {
+        size_t n = hi - lo < kStage ? hi - lo : kStage;
+        blake3_hasher_finalize_seek(&h, lo, stage, n);
+        // lo - kASize is a multiple of kNDim: chunk bounds are block aligned.
+        size_t k = (lo - kASize) / kNDim;
+        for (size_t off = 0; off < n; off += kNDim, ++k) {
+            std::memcpy(d.b + k * d.b_stride, stage + off, kNDim);
+        }
+        lo += n;
+    }
+}
+
+void fill(const blake3_hasher &h, const Dest &d, size_t lo, size_t hi) {
+    if (lo < kASize) fill_a(h, d, lo, hi < kASize ? hi : kASize);
+    if (hi > kASize) fill_b(h, d, lo > kASize ? lo : kASize, hi);
+}
+} // namespace
+
+void expand_ab_strided(const uint8_t seed[kSeedSize], uint8_t *a, size_t a_stride, int8_t *b, size_t b_stride,
+                       unsigned threads) {
+    static_assert(kASize % kXofBlock == 0, "B starts on an XOF block boundary");
+    blake3_hasher h;
+    blake3_hasher_init(&h);
+    blake3_hasher_update(&h, seed, kSeedSize);
+    Dest d = {a, a_stride, b, b_stride};
+
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    size_t max_threads = kABSize / kMinChunk;
+    if (threads > max_threads) threads = static_cast<unsigned>(max_threads);
+    if (threads <= 1) {
+        fill(h, d, 0, kABSize);
+        return;
+    }
+
+    size_t blocks = kABSize / kXofBlock;
+    size_t per = (blocks + threads - 1) / threads * kXofBlock;
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads && t * per < kABSize; ++t) {
+        size_t lo = t * per;
+        size_t hi = lo + per < kABSize ? lo + per : kABSize;
+        pool.emplace_back([&h, &d, lo, hi]() { fill(h, d, lo, hi); });
+    }
+    fill(h, d, 0, per);
+    for (auto &th : pool) th.join();
+}
+
+} // namespace upow
@@ -0,0 +1,25 @@
+#ifndef UPOW_EXPAND_H
+#define UPOW_EXPAND_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "upow.h"
+
+namespace upow {
+
+// Same bytes as expand_ab, written straight into strided destinations:
+// A row i (K bytes) at a + i * a_stride and B row k (N bytes) at
+// b + k * b_stride, so callers can hand in zero-padded, tile-aligned
+// buffers once and reuse them. Padding bytes are never written.
+//
+// The XOF output is split into block-aligned ranges that `threads` workers
+// (0 = all cores) produce independently with blake3_hasher_finalize_seek.
+// A rows are generated in place; B rows go through a small per-thread
+// staging buffer unless b_stride == kNDim.
+void expand_ab_strided(const uint8_t seed[kSeedSize], uint8_t *a, size_t a_stride, int8_t *b, size_t b_stride,
+                       unsigned threads);
+
+} // namespace upow
+
+#endif /* UPOW_EXPAND_H */
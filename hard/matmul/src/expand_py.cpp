@@ -0,0 +1,87 @@
+// Python binding for expand_ab_strided: upow_expand.expand_into(seed, a, b,
+// threads=0) fills caller-owned writable 2-D byte buffers (e.g. the padded
+// numpy arrays ttnn_upow.py hands to torch) without the GIL held.
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "expand.h"
+
+namespace {
+
+// Checks a writable 2-D buffer of one-byte items with contiguous rows and at
+// least rows x cols elements; returns its row stride.
+bool check_matrix(const Py_buffer &view, Py_ssize_t rows, Py_ssize_t cols, const char *name, size_t &stride) {
+    if (view.ndim != 2 || view.itemsize != 1) {
+        PyErr_Format(PyExc_ValueError, "%s must be a 2-D buffer of 1-byte items", name);
+        return false;
+    }
+    if (view.shape[0] < rows || view.shape[1] < cols) {
+        PyErr_Format(PyExc_ValueError, "%s must be at least %zd x %zd", name, rows, cols);
+        return false;
+    }
+    if (view.strides[1] != 1 || view.strides[0] < view.shape[1]) {
+        PyErr_Format(PyExc_ValueError, "%s rows must be contiguous", name);
+        return false;
+    }
+    stride = static_cast<size_t>(view.strides[0]);
+    return true;
+}
+
+PyObject *expand_into(PyObject *, PyObject *args, PyObject *kwargs) {
+    static const char *kwlist[] = {"seed", "a", "b", "threads", nullptr};
+    Py_buffer seed = {};
+    PyObject *a_obj = nullptr;
+    PyObject *b_obj = nullptr;
+    unsigned threads = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "y*OO|I", const_cast<char **>(kwlist), &seed, &a_obj, &b_obj,
+                                     &threads)) {
+        return nullptr;
+    }
+    // w* only guarantees a flat buffer; the row strides need PyBUF_STRIDES.
+    Py_buffer a = {};
+    Py_buffer b = {};
+    bool have_a = PyObject_GetBuffer(a_obj, &a, PyBUF_STRIDES | PyBUF_WRITABLE) == 0;
+    bool have_b = have_a && PyObject_GetBuffer(b_obj, &b, PyBUF_STRIDES | PyBUF_WRITABLE) == 0;
+    PyObject *result = nullptr;
+    size_t a_stride = 0;
+    size_t b_stride = 0;
+    if (!have_b) {
+        // PyObject_GetBuffer has set the exception.
+    } else if (seed.len != static_cast<Py_ssize_t>(upow::kSeedSize)) {
+        PyErr_Format(PyExc_ValueError, "seed must be %zu bytes", upow::kSeedSize);
+    } else if (check_matrix(a, upow::kMDim, upow::kKDim, "a", a_stride) &&
+               check_matrix(b, upow::kKDim, upow::kNDim, "b", b_stride)) {
+        Py_BEGIN_ALLOW_THREADS
+        upow::expand_ab_strided(static_cast<const uint8_t *>(seed.buf), static_cast<uint8_t *>(a.buf), a_stride,
+                                static_cast<int8_t *>(b.buf), b_stride, threads);
+        Py_END_ALLOW_THREADS
+        result = Py_None;
+        Py_INCREF(result);
+    }
+    if (have_b) PyBuffer_Release(&b);
+    if (have_a) PyBuffer_Release(&a);
+    PyBuffer_Release(&seed);
+    return result;
+}
+
+PyMethodDef kMethods[] = {
+    {"expand_into", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(expand_into)),
+     METH_VARARGS | METH_KEYWORDS,
+     "expand_into(seed, a, b, threads=0)\n\n"
+     "Writes blake3(seed).digest(2*M*K) into a[:M, :K] (u8) and b[:K, :N] (i8)."},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+PyModuleDef kModule = {
+    PyModuleDef_HEAD_INIT, "upow_expand", "Parallel BLAKE3 XOF expansion of uPoW A/B matrices.", -1, kMethods,
+};
+} // namespace
+
+PyMODINIT_FUNC PyInit_upow_expand(void) {
+    PyObject *m = PyModule_Create(&kModule);
+    if (!m) return nullptr;
+    PyModule_AddIntConstant(m, "M_DIM", static_cast<long>(upow::kMDim));
+    PyModule_AddIntConstant(m, "K_DIM", static_cast<long>(upow::kKDim));
+    PyModule_AddIntConstant(m, "N_DIM", static_cast<long>(upow::kNDim));
+    return m;
+}
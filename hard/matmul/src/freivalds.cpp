@@ -0,0 +1,187 @@
+#include "freivalds.h"
+
+#include <cstring>
+
+#include "blake3.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(UPOW_NO_AVX2)
+#define UPOW_HAVE_AVX2 1
+#include <immintrin.h>
+#else
+#define UPOW_HAVE_AVX2 0
+#endif
+
+namespace upow {
+namespace {
+
+static_assert(kNDim == 16, "kernels hold one B row in a 16 x i16 vector");
+static_assert(kKDim % 8 == 0, "AVX2 kernels consume K eight at a time");
+
+// |B r| <= 16 * 128 * 2^15 = 2^26 fits i32; |A (B r)| <= K * 255 * 2^26 and
+// |C r| <= 16 * 2^31 * 2^15 both fit i64, so no check ever wraps.
+using Vec16 = int16_t[kNDim];
+
+uint64_t splitmix64(uint64_t &s) {
+    uint64_t z = (s += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+void br_portable(const int8_t *b, const Vec16 r, int32_t *br) {
+    for (size_t k = 0; k < kKDim; ++k) {
+        const int8_t *row = b + k * kNDim;
+        int32_t s = 0;
+        for (size_t j = 0; j < kNDim; ++j) s += row[j] * r[j];
+        br[k] = s;
+    }
+}
+
+void abr_portable(const uint8_t *a, const int32_t *br, int64_t y[kMDim]) {
+    for (size_t i = 0; i < kMDim; ++i) {
+        const uint8_t *row = a + i * kKDim;
+        int64_t s = 0;
+        for (size_t k = 0; k < kKDim; ++k) s += static_cast<int64_t>(row[k]) * br[k];
+        y[i] = s;
+    }
+}
+
+#if UPOW_HAVE_AVX2
+// Eight rows of B at a time: one madd per row against r gives eight pair
+// sums, and a hadd tree folds the eight rows into one vector of B r.
+__attribute__((target("avx2")))
+void br_avx2(const int8_t *b, const Vec16 r, int32_t *br) {
+    __m256i rv = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(r));
+    for (size_t k = 0; k < kKDim; k += 8) {
+        __m256i m[8];
+        for (size_t t = 0; t < 8; ++t) {
+            __m128i row = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + (k + t) * kNDim));
+            m[t] = _mm256_madd_epi16(_mm256_cvtepi8_epi16(row), rv);
+        }
+        __m256i u0 = _mm256_hadd_epi32(_mm256_hadd_epi32(m[0], m[1]), _mm256_hadd_epi32(m[2], m[3]));
+        __m256i u1 = _mm256_hadd_epi32(_mm256_hadd_epi32(m[4], m[5]), _mm256_hadd_epi32(m[6], m[7]));
+        __m256i sum = _mm256_add_epi32(_mm256_permute2x128_si256(u0, u1, 0x20),
+                                       _mm256_permute2x128_si256(u0, u1, 0x31));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(br + k), sum);
+    }
+}
+
+// A rows widened to i32 and multiplied into i64 lanes: mul_epi32 takes the
+// even lanes, a 32-bit shift of both operands the odd ones.
+__attribute__((target("avx2")))
+void abr_avx2(const uint8_t *a, const int32_t *br, int64_t y[kMDim]) {
+    for (size_t i = 0; i < kMDim; ++i) {
+        const uint8_t *row = a + i * kKDim;
+        __m256i acc0 = _mm256_setzero_si256();
+        __m256i acc1 = _mm256_setzero_si256();
+        for (size_t k = 0; k < kKDim; k += 8) {
+            __m256i av = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(row + k)));
+            __m256i bv = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(br + k));
+            acc0 = _mm256_add_epi64(acc0, _mm256_mul_epi32(av, bv));
+            acc1 = _mm256_add_epi64(acc1, _mm256_mul_epi32(_mm256_srli_epi64(av, 32), _mm256_srli_epi64(bv, 32)));
+        }
+        alignas(32) int64_t lanes[4];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), _mm256_add_epi64(acc0, acc1));
+        y[i] = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+}
+
+bool cpu_has_avx2() {
+    static const bool has = __builtin_cpu_supports("avx2");
+    return has;
+}
+#endif
+
+void br(const int8_t *b, const Vec16 r, int32_t *out) {
+#if UPOW_HAVE_AVX2
+    if (cpu_has_avx2()) {
+        br_avx2(b, r, out);
+        return;
+    }
+#endif
+    br_portable(b, r, out);
+}
+
+void abr(const uint8_t *a, const int32_t *brv, int64_t y[kMDim]) {
+#if UPOW_HAVE_AVX2
+    if (cpu_has_avx2()) {
+        abr_avx2(a, brv, y);
+        return;
+    }
+#endif
+    abr_portable(a, brv, y);
+}
+} // namespace
+
+bool freivalds_check(const uint8_t *a, const int8_t *b, const int32_t c[kMDim * kNDim], unsigned rounds,
+                     uint64_t rng_seed) {
+    alignas(32) int32_t brv[kKDim];
+    uint64_t state = rng_seed;
+    for (unsigned round = 0; round < rounds; ++round) {
+        alignas(32) Vec16 r;
+        for (size_t j = 0; j < kNDim; j += 4) {
+            uint64_t bits = splitmix64(state);
+            for (size_t t = 0; t < 4; ++t) r[j + t] = static_cast<int16_t>(bits >> (16 * t));
+        }
+        br(b, r, brv);
+        int64_t y[kMDim];
+        abr(a, brv, y);
+        for (size_t i = 0; i < kMDim; ++i) {
+            int64_t cr = 0;
+            for (size_t j = 0; j < kNDim; ++j) cr += static_cast<int64_t>(c[i * kNDim + j]) * r[j];
+            if (cr != y[i]) return false;
+        }
+    }
+    return true;
+}
+
+const char *freivalds_backend() {
+#if UPOW_HAVE_AVX2
+    if (cpu_has_avx2()) return "avx2";
+#endif
+    return "portable";
+}
+
+const char *verdict_name(Verdict v) {
+    switch (v) {
+    case Verdict::kOk:
+        return "ok";
+    case Verdict::kBadSize:
+        return "size";
+    case Verdict::kBadMath:
+        return "math";
+    case Verdict::kDifficulty:
+        return "difficulty";
+    }
+    return "unknown";
+}
+
+Verification verify_solution(const uint8_t *solution, size_t len, unsigned rounds, unsigned target_bits,
+                             uint64_t rng_seed, uint8_t *ab) {
+    Verification v;
+    if (len != kSolutionSize) return v;
+
+    uint8_t digest[kHashSize];
+    blake3_hasher h;
+    blake3_hasher_init(&h);
+    blake3_hasher_update(&h, solution, kSolutionSize);
+    blake3_hasher_finalize(&h, digest, sizeof(digest));
+    v.bits = leading_zero_bits(digest, sizeof(digest));
+
+    int32_t c[kMDim * kNDim];
+    const uint8_t *cb = solution + kSeedSize;
+    for (size_t i = 0; i < kMDim * kNDim; ++i) {
+        c[i] = static_cast<int32_t>(static_cast<uint32_t>(cb[4 * i]) | (static_cast<uint32_t>(cb[4 * i + 1]) << 8) |
+                                    (static_cast<uint32_t>(cb[4 * i + 2]) << 16) |
+                                    (static_cast<uint32_t>(cb[4 * i + 3]) << 24));
+    }
+    expand_ab(solution, ab);
+    if (!freivalds_check(ab, reinterpret_cast<const int8_t *>(ab + kASize), c, rounds, rng_seed)) {
+        v.verdict = Verdict::kBadMath;
+        return v;
+    }
+    v.verdict = target_bits != 0 && v.bits < target_bits ? Verdict::kDifficulty : Verdict::kOk;
+    return v;
+}
+
+} // namespace upow
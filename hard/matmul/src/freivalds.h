@@ -0,0 +1,45 @@
+#ifndef UPOW_FREIVALDS_H
+#define UPOW_FREIVALDS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "upow.h"
+
+namespace upow {
+
+// Randomised check of C == A * B without recomputing the product: for a
+// random vector r, A * (B * r) == C * r costs two matrix-vector products.
+// r is drawn from i16, so with exact i32/i64 arithmetic a wrong C passes
+// one round with probability at most 2^-16; `rounds` independent vectors
+// bring that to 2^(-16 * rounds).
+constexpr unsigned kDefaultFreivaldsRounds = 4;
+
+// a, b as produced by expand_ab; c is M x N row-major.
+bool freivalds_check(const uint8_t *a, const int8_t *b, const int32_t c[kMDim * kNDim], unsigned rounds,
+                     uint64_t rng_seed);
+const char *freivalds_backend();
+
+enum class Verdict {
+    kOk,
+    kBadSize,     // not seed || C
+    kBadMath,     // C != A * B
+    kDifficulty,  // blake3(solution) below the requested leading zero bits
+};
+
+const char *verdict_name(Verdict v);
+
+struct Verification {
+    Verdict verdict = Verdict::kBadSize;
+    unsigned bits = 0;  // leading zero bits of blake3(solution)
+};
+
+// Full local validation of one solution blob: size, then the Freivalds
+// check on A/B regenerated from its seed, then target_bits (0 = skip).
+// ab is scratch of kABSize bytes.
+Verification verify_solution(const uint8_t *solution, size_t len, unsigned rounds, unsigned target_bits,
+                             uint64_t rng_seed, uint8_t *ab);
+
+} // namespace upow
+
+#endif /* UPOW_FREIVALDS_H */
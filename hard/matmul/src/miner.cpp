@@ -0,0 +1,213 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "upow.h"
+
+namespace {
+
+struct Options {
+    const char *seed_hex = nullptr;
+    const char *seed_bin = nullptr;
+    unsigned threads = 0;
+    unsigned target_bits = 0;
+    uint64_t max_iters = 0;
+    uint64_t print_every = 1;
+    const char *nonce_start = nullptr;
+    bool print_solution = true;
+};
+
+// Workers count hashes and track the best bits lock-free; mu is taken only
+// to publish a new best solution, print a progress line, or report a find.
+struct State {
+    std::atomic<uint64_t> issued{0};
+    std::atomic<uint64_t> hashes{0};
+    std::atomic<int> best_bits{-1};
+    std::atomic<bool> stop{false};
+    std::mutex mu;
+    bool found = false;
+    uint8_t best_solution[upow::kSolutionSize];
+    std::chrono::steady_clock::time_point start;
+};
+
+void die(const char *msg) {
+    std::fprintf(stderr, "%s\n", msg);
+    std::exit(1);
+}
+
+const char *env_or(const char *name, const char *fallback) {
+    const char *v = std::getenv(name);
+    return (v && *v) ? v : fallback;
+}
+
+uint64_t parse_u64(const char *s, const char *what) {
+    char *end = nullptr;
+    unsigned long long v = std::strtoull(s, &end, 0);
+    if (!s[0] || *end != '\0') {
+        std::fprintf(stderr, "Invalid %s: %s\n", what, s);
+        std::exit(1);
+    }
+    return static_cast<uint64_t>(v);
+}
+
+void usage() {
+    std::fprintf(stderr,
+                 "usage: upow_miner [--seed-hex HEX | --seed-bin PATH] [--threads N]\n"
+                 "                  [--target-bits N] [--max-iters N] [--print-every N]\n"
+                 "                  [--nonce-start N] [--no-solution]\n");
+    std::exit(1);
+}
+
+Options parse_args(int argc, char **argv) {
+    Options opt;
+    opt.seed_hex = env_or("SEED_HEX", nullptr);
+    opt.seed_bin = env_or("SEED_BIN", nullptr);
+    opt.target_bits = static_cast<unsigned>(parse_u64(env_or("TARGET_BITS", "0"), "TARGET_BITS"));
+    opt.max_iters = parse_u64(env_or("MAX_ITERS", "0"), "MAX_ITERS");
+    opt.print_every = parse_u64(env_or("PRINT_EVERY", "1"), "PRINT_EVERY");
+    opt.threads = static_cast<unsigned>(parse_u64(env_or("MINER_THREADS", "0"), "MINER_THREADS"));
+    opt.nonce_start = env_or("NONCE_START", nullptr);
+
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        auto value = [&]() -> const char * {
+            if (i + 1 >= argc) usage();
+            return argv[++i];
+        };
+        if (!std::strcmp(arg, "--seed-hex")) {
+            opt.seed_hex = value();
+        } else if (!std::strcmp(arg, "--seed-bin")) {
+            opt.seed_bin = value();
+        } else if (!std::strcmp(arg, "--threads")) {
+            opt.threads = static_cast<unsigned>(parse_u64(value(), "--threads"));
+        } else if (!std::strcmp(arg, "--target-bits")) {
+            opt.target_bits = static_cast<unsigned>(parse_u64(value(), "--target-bits"));
+        } else if (!std::strcmp(arg, "--max-iters")) {
+            opt.max_iters = parse_u64(value(), "--max-iters");
+        } else if (!std::strcmp(arg, "--print-every")) {
+            opt.print_every = parse_u64(value(), "--print-every");
+        } else if (!std::strcmp(arg, "--nonce-start")) {
+            opt.nonce_start = value();
+        } else if (!std::strcmp(arg, "--no-solution")) {
+            opt.print_solution = false;
+        } else {
+            usage();
+        }
+    }
+    if (opt.print_every == 0) opt.print_every = 1;
+    if (opt.threads == 0) {
+        opt.threads = std::thread::hardware_concurrency();
+        if (opt.threads == 0) opt.threads = 1;
+    }
+    return opt;
+}
+
+void load_seed(const Options &opt, uint8_t seed[upow::kSeedSize]) {
+    if (opt.seed_hex) {
+        if (!upow::hex_to_bytes(opt.seed_hex, seed, upow::kSeedSize)) {
+            die("Invalid seed hex (expected 480 hex chars).");
+        }
+        return;
+    }
+    if (!opt.seed_bin) die("Missing seed. Provide --seed-hex, --seed-bin, or SEED_HEX/SEED_BIN.");
+    FILE *f = std::fopen(opt.seed_bin, "rb");
+    if (!f) die("Failed to open seed file.");
+    uint8_t extra;
+    size_t n = std::fread(seed, 1, upow::kSeedSize, f);
+    bool trailing = std::fread(&extra, 1, 1, f) == 1;
+    std::fclose(f);
+    if (n != upow::kSeedSize || trailing) die("Seed size mismatch. Expected 240 bytes.");
+}
+
+double elapsed_sec(const State &st) {
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - st.start;
+    return d.count();
+}
+
+void worker(const Options &opt, const uint8_t base_seed[upow::kSeedSize], uint64_t nonce_base, State &st) {
+    std::vector<uint8_t> ab(upow::kABSize);
+    uint8_t seed[upow::kSeedSize];
+    uint8_t solution[upow::kSolutionSize];
+    std::memcpy(seed, base_seed, sizeof(seed));
+
+    while (!st.stop.load(std::memory_order_relaxed)) {
+        uint64_t idx = st.issued.fetch_add(1, std::memory_order_relaxed);
+        if (opt.max_iters != 0 && idx >= opt.max_iters) break;
+        uint64_t nonce = nonce_base + idx;
+        upow::store_nonce(seed, nonce);
+        unsigned bits = upow::solve(seed, ab.data(), solution);
+        if (st.stop.load(std::memory_order_relaxed)) break;
+
+        uint64_t hashes = st.hashes.fetch_add(1, std::memory_order_relaxed) + 1;
+        bool improved = static_cast<int>(bits) > st.best_bits.load(std::memory_order_relaxed);
+        bool report = hashes % opt.print_every == 0;
+        bool hit = opt.target_bits != 0 && bits >= opt.target_bits;
+        if (!improved && !report && !hit) continue;
+
+        std::lock_guard<std::mutex> lock(st.mu);
+        if (st.found) break;
+        if (static_cast<int>(bits) > st.best_bits.load(std::memory_order_relaxed)) {
+            st.best_bits.store(static_cast<int>(bits), std::memory_order_relaxed);
+            std::memcpy(st.best_solution, solution, sizeof(solution));
+        }
+        unsigned best = static_cast<unsigned>(st.best_bits.load(std::memory_order_relaxed));
+        double secs = elapsed_sec(st);
+        double rate = secs > 0.0 ? static_cast<double>(hashes) / secs : 0.0;
+        if (report) {
+            std::printf("hashes=%llu rate_h/s=%.3f best=%u bits=%u nonce=%llu\n",
+                        static_cast<unsigned long long>(hashes), rate, best, bits,
+                        static_cast<unsigned long long>(nonce));
+        }
+        if (hit) {
+            st.found = true;
+            std::memcpy(st.best_solution, solution, sizeof(solution));
+            std::printf("FOUND! nonce=%llu bits=%u rate_avg_h/s=%.3f\n",
+                        static_cast<unsigned long long>(nonce), bits, rate);
+            st.stop.store(true, std::memory_order_relaxed);
+        }
+        if (report || hit) std::fflush(stdout);
+        if (hit) break;
+    }
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opt = parse_args(argc, argv);
+    uint8_t seed[upow::kSeedSize];
+    load_seed(opt, seed);
+    uint64_t nonce_base = opt.nonce_start ? parse_u64(opt.nonce_start, "nonce start") : upow::load_nonce(seed);
+
+    std::fprintf(stderr, ">> native miner threads=%u kernel=%s nonce_start=%llu\n", opt.threads,
+                 upow::matmul_backend(), static_cast<unsigned long long>(nonce_base));
+
+    State st;
+    st.start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    pool.reserve(opt.threads);
+    for (unsigned t = 0; t < opt.threads; ++t) {
+        pool.emplace_back(worker, std::cref(opt), seed, nonce_base, std::ref(st));
+    }
+    for (auto &th : pool) th.join();
+
+    double secs = elapsed_sec(st);
+    uint64_t hashes = st.hashes.load();
+    int best = st.best_bits.load();
+    std::printf("{\"mode\":\"native_upow\",\"threads\":%u,\"kernel\":\"%s\",\"hashes\":%llu,"
+                "\"elapsed_ms\":%.3f,\"rate_h/s\":%.3f,\"best\":%u,\"found\":%s}\n",
+                opt.threads, upow::matmul_backend(), static_cast<unsigned long long>(hashes),
+                secs * 1000.0, secs > 0.0 ? static_cast<double>(hashes) / secs : 0.0, best < 0 ? 0u : unsigned(best),
+                st.found ? "true" : "false");
+    if (opt.print_solution && best >= 0) {
+        std::vector<char> hex(2 * upow::kSolutionSize + 1);
+        upow::bytes_to_hex(st.best_solution, upow::kSolutionSize, hex.data());
+        std::printf("solution_hex=%s\n", hex.data());
+    }
+    std::fflush(stdout);
+    return 0;
+}
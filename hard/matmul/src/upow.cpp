@@ -0,0 +1,213 @@
+#include "upow.h"
+
+#include <cstring>
+
+#include "blake3.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(UPOW_NO_AVX2)
+#define UPOW_HAVE_AVX2 1
+#include <immintrin.h>
+#else
+#define UPOW_HAVE_AVX2 0
+#endif
+
+namespace upow {
+namespace {
+
+// K is walked in blocks so the B slice (and its widened copy in the AVX2
+// kernel) stays in L1 while all 16 rows of A stream past it.
+constexpr size_t kKBlock = 320;
+static_assert(kKDim % 2 == 0, "AVX2 kernel consumes K in pairs");
+static_assert(kKBlock % 2 == 0, "AVX2 kernel consumes K in pairs");
+
+int hex_val(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return 10 + (c - 'a');
+    if (c >= 'A' && c <= 'F') return 10 + (c - 'A');
+    return -1;
+}
+
+#if UPOW_HAVE_AVX2
+__attribute__((target("avx2")))
+void matmul_avx2(const uint8_t *a, const int8_t *b, int32_t c[kMDim * kNDim]) {
+    // B rows k and k+1 interleaved and widened to i16 so that one madd
+    // yields a[k]*b[k][j] + a[k+1]*b[k+1][j] for eight columns at once.
+    __m256i bpairs[kKBlock / 2][2];
+    __m256i acc[kMDim][2];
+    for (size_t i = 0; i < kMDim; ++i) {
+        acc[i][0] = _mm256_setzero_si256();
+        acc[i][1] = _mm256_setzero_si256();
+    }
+
+    for (size_t k0 = 0; k0 < kKDim; k0 += kKBlock) {
+        size_t k1 = k0 + kKBlock < kKDim ? k0 + kKBlock : kKDim;
+        size_t pairs = (k1 - k0) / 2;
+        for (size_t p = 0; p < pairs; ++p) {
+            const int8_t *brow = b + (k0 + 2 * p) * kNDim;
+            __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(brow));
+            __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(brow + kNDim));
+            bpairs[p][0] = _mm256_cvtepi8_epi16(_mm_unpacklo_epi8(r0, r1));
+            bpairs[p][1] = _mm256_cvtepi8_epi16(_mm_unpackhi_epi8(r0, r1));
+        }
+        for (size_t i0 = 0; i0 < kMDim; i0 += 4) {
+            __m256i c00 = acc[i0 + 0][0], c01 = acc[i0 + 0][1];
+            __m256i c10 = acc[i0 + 1][0], c11 = acc[i0 + 1][1];
+            __m256i c20 = acc[i0 + 2][0], c21 = acc[i0 + 2][1];
+            __m256i c30 = acc[i0 + 3][0], c31 = acc[i0 + 3][1];
+            const uint8_t *a0 = a + (i0 + 0) * kKDim + k0;
+            const uint8_t *a1 = a + (i0 + 1) * kKDim + k0;
+            const uint8_t *a2 = a + (i0 + 2) * kKDim + k0;
+            const uint8_t *a3 = a + (i0 + 3) * kKDim + k0;
+            for (size_t p = 0; p < pairs; ++p) {
+                __m256i b0 = bpairs[p][0];
+                __m256i b1 = bpairs[p][1];
+                __m256i v0 = _mm256_set1_epi32(static_cast<int32_t>(a0[2 * p] | (a0[2 * p + 1] << 16)));
+                __m256i v1 = _mm256_set1_epi32(static_cast<int32_t>(a1[2 * p] | (a1[2 * p + 1] << 16)));
+                __m256i v2 = _mm256_set1_epi32(static_cast<int32_t>(a2[2 * p] | (a2[2 * p + 1] << 16)));
+                __m256i v3 = _mm256_set1_epi32(static_cast<int32_t>(a3[2 * p] | (a3[2 * p + 1] << 16)));
+                c00 = _mm256_add_epi32(c00, _mm256_madd_epi16(b0, v0));
+                c01 = _mm256_add_epi32(c01, _mm256_madd_epi16(b1, v0));
+                c10 = _mm256_add_epi32(c10, _mm256_madd_epi16(b0, v1));
+                c11 = _mm256_add_epi32(c11, _mm256_madd_epi16(b1, v1));
+                c20 = _mm256_add_epi32(c20, _mm256_madd_epi16(b0, v2));
+                c21 = _mm256_add_epi32(c21, _mm256_madd_epi16(b1, v2));
+                c30 = _mm256_add_epi32(c30, _mm256_madd_epi16(b0, v3));
+                c31 = _mm256_add_epi32(c31, _mm256_madd_epi16(b1, v3));
+            }
+            acc[i0 + 0][0] = c00; acc[i0 + 0][1] = c01;
+            acc[i0 + 1][0] = c10; acc[i0 + 1][1] = c11;
+            acc[i0 + 2][0] = c20; acc[i0 + 2][1] = c21;
+            acc[i0 + 3][0] = c30; acc[i0 + 3][1] = c31;
+        }
+    }
+
+    for (size_t i = 0; i < kMDim; ++i) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(c + i * kNDim), acc[i][0]);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(c + i * kNDim + 8), acc[i][1]);
+    }
+}
+
+bool cpu_has_avx2() {
+    static const bool has = __builtin_cpu_supports("avx2");
+    return has;
+}
+#endif
+} // namespace
+
+bool hex_to_bytes(const char *hex, uint8_t *out, size_t out_len) {
+    size_t len = std::strlen(hex);
+    if (len != out_len * 2) return false;
+    for (size_t i = 0; i < out_len; ++i) {
+        int hi = hex_val(hex[2 * i]);
+        int lo = hex_val(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        out[i] = static_cast<uint8_t>((hi << 4) | lo);
+    }
+    return true;
+}
+
+void bytes_to_hex(const uint8_t *in, size_t len, char *out) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; ++i) {
+        out[2 * i] = digits[in[i] >> 4];
+        out[2 * i + 1] = digits[in[i] & 0x0f];
+    }
+    out[2 * len] = '\0';
+}
+
+uint64_t load_nonce(const uint8_t seed[kSeedSize]) {
+    uint64_t nonce = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        nonce |= static_cast<uint64_t>(seed[kNonceOffset + i]) << (8 * i);
+    }
+    return nonce;
+}
+
+void store_nonce(uint8_t seed[kSeedSize], uint64_t nonce) {
+    for (size_t i = 0; i < 8; ++i) {
+        seed[kNonceOffset + i] = static_cast<uint8_t>(nonce >> (8 * i));
+    }
+}
+
+void expand_ab(const uint8_t seed[kSeedSize], uint8_t *ab) {
+    blake3_hasher h;
+    blake3_hasher_init(&h);
+    blake3_hasher_update(&h, seed, kSeedSize);
+    blake3_hasher_finalize(&h, ab, kABSize);
+}
+
+void matmul_portable(const uint8_t *a, const int8_t *b, int32_t c[kMDim * kNDim]) {
+    int32_t acc[kMDim][kNDim] = {};
+    for (size_t k0 = 0; k0 < kKDim; k0 += kKBlock) {
+        size_t k1 = k0 + kKBlock < kKDim ? k0 + kKBlock : kKDim;
+        for (size_t i = 0; i < kMDim; ++i) {
+            const uint8_t *arow = a + i * kKDim;
+            int32_t *crow = acc[i];
+            for (size_t k = k0; k < k1; ++k) {
+                int32_t av = arow[k];
+                const int8_t *brow = b + k * kNDim;
+                for (size_t j = 0; j < kNDim; ++j) {
+                    crow[j] += av * brow[j];
+                }
+            }
+        }
+    }
+    std::memcpy(c, acc, sizeof(acc));
+}
+
+void matmul(const uint8_t *a, const int8_t *b, int32_t c[kMDim * kNDim]) {
+#if UPOW_HAVE_AVX2
+    if (cpu_has_avx2()) {
+        matmul_avx2(a, b, c);
+        return;
+    }
+#endif
+    matmul_portable(a, b, c);
+}
+
+const char *matmul_backend() {
+#if UPOW_HAVE_AVX2
+    if (cpu_has_avx2()) return "avx2";
+#endif
+    return "portable";
+}
+
+void store_c(const int32_t c[kMDim * kNDim], uint8_t out[kCSize]) {
+    for (size_t i = 0; i < kMDim * kNDim; ++i) {
+        uint32_t v = static_cast<uint32_t>(c[i]);
+        out[4 * i + 0] = static_cast<uint8_t>(v);
+        out[4 * i + 1] = static_cast<uint8_t>(v >> 8);
+        out[4 * i + 2] = static_cast<uint8_t>(v >> 16);
+        out[4 * i + 3] = static_cast<uint8_t>(v >> 24);
+    }
+}
+
+unsigned leading_zero_bits(const uint8_t *digest, size_t len) {
+    unsigned bits = 0;
+    for (size_t i = 0; i < len; ++i) {
+        if (digest[i] == 0) {
+            bits += 8;
+            continue;
+        }
+        bits += static_cast<unsigned>(__builtin_clz(digest[i])) - 24;
+        break;
+    }
+    return bits;
+}
+
+unsigned solve(const uint8_t seed[kSeedSize], uint8_t *ab, uint8_t solution[kSolutionSize]) {
+    int32_t c[kMDim * kNDim];
+    expand_ab(seed, ab);
+    matmul(ab, reinterpret_cast<const int8_t *>(ab + kASize), c);
+    std::memcpy(solution, seed, kSeedSize);
+    store_c(c, solution + kSeedSize);
+
+    uint8_t digest[kHashSize];
+    blake3_hasher h;
+    blake3_hasher_init(&h);
+    blake3_hasher_update(&h, solution, kSolutionSize);
+    blake3_hasher_finalize(&h, digest, sizeof(digest));
+    return leading_zero_bits(digest, sizeof(digest));
+}
+
+} // namespace upow
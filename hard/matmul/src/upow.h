@@ -0,0 +1,54 @@
+#ifndef UPOW_H
+#define UPOW_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace upow {
+
+constexpr size_t kSeedSize = 240;
+constexpr size_t kMDim = 16;
+constexpr size_t kKDim = 50240;
+constexpr size_t kNDim = 16;
+
+// A (u8, M x K) and B (i8, K x N) are the first and second halves of the
+// BLAKE3 XOF of the seed, both row-major.
+constexpr size_t kASize = kMDim * kKDim;
+constexpr size_t kBSize = kKDim * kNDim;
+constexpr size_t kABSize = kASize + kBSize;
+
+// C is i32 little-endian, M x N row-major. Solution = seed || C.
+constexpr size_t kCSize = kMDim * kNDim * sizeof(int32_t);
+constexpr size_t kSolutionSize = kSeedSize + kCSize;
+
+// The miner varies the low 64 bits of the nonce (last 8 seed bytes, LE).
+constexpr size_t kNonceOffset = kSeedSize - 8;
+
+constexpr size_t kHashSize = 32;
+
+bool hex_to_bytes(const char *hex, uint8_t *out, size_t out_len);
+void bytes_to_hex(const uint8_t *in, size_t len, char *out);
+
+uint64_t load_nonce(const uint8_t seed[kSeedSize]);
+void store_nonce(uint8_t seed[kSeedSize], uint64_t nonce);
+
+// Writes the kABSize-byte XOF expansion of seed into ab (A then B).
+void expand_ab(const uint8_t seed[kSeedSize], uint8_t *ab);
+
+// C = A * B with i32 accumulation. Dispatches to the widest kernel the CPU
+// supports; matmul_portable is the reference used on every other target.
+void matmul(const uint8_t *a, const int8_t *b, int32_t c[kMDim * kNDim]);
+void matmul_portable(const uint8_t *a, const int8_t *b, int32_t c[kMDim * kNDim]);
+const char *matmul_backend();
+
+void store_c(const int32_t c[kMDim * kNDim], uint8_t out[kCSize]);
+
+unsigned leading_zero_bits(const uint8_t *digest, size_t len);
+
+// Full pipeline for one seed: fills solution (seed || C) and returns the
+// leading zero bits of blake3(solution). ab is scratch of kABSize bytes.
+unsigned solve(const uint8_t seed[kSeedSize], uint8_t *ab, uint8_t solution[kSolutionSize]);
+
+} // namespace upow
+
+#endif /* UPOW_H */
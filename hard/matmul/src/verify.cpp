@@ -0,0 +1,163 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "freivalds.h"
+#include "upow.h"
+
+namespace {
+
+struct Options {
+    unsigned threads = 0;
+    unsigned rounds = upow::kDefaultFreivaldsRounds;
+    unsigned target_bits = 0;
+    const char *rng_seed = nullptr;
+    const char *solution_hex = nullptr;
+    std::vector<const char *> files;
+};
+
+void die(const char *msg) {
+    std::fprintf(stderr, "%s\n", msg);
+    std::exit(1);
+}
+
+const char *env_or(const char *name, const char *fallback) {
+    const char *v = std::getenv(name);
+    return (v && *v) ? v : fallback;
+}
+
+uint64_t parse_u64(const char *s, const char *what) {
+    char *end = nullptr;
+    unsigned long long v = std::strtoull(s, &end, 0);
+    if (!s[0] || *end != '\0') {
+        std::fprintf(stderr, "Invalid %s: %s\n", what, s);
+        std::exit(1);
+    }
+    return static_cast<uint64_t>(v);
+}
+
+void usage() {
+    std::fprintf(stderr,
+                 "usage: upow_verify [--rounds N] [--threads N] [--target-bits N] [--rng-seed N]\n"
+                 "                   (--solution-hex HEX | FILE...)\n");
+    std::exit(1);
+}
+
+Options parse_args(int argc, char **argv) {
+    Options opt;
+    opt.threads = static_cast<unsigned>(parse_u64(env_or("VERIFY_THREADS", "0"), "VERIFY_THREADS"));
+    if (const char *rounds = env_or("FREIVALDS_ROUNDS", nullptr)) {
+        opt.rounds = static_cast<unsigned>(parse_u64(rounds, "FREIVALDS_ROUNDS"));
+    }
+
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        auto value = [&]() -> const char * {
+            if (i + 1 >= argc) usage();
+            return argv[++i];
+        };
+        if (!std::strcmp(arg, "--rounds")) {
+            opt.rounds = static_cast<unsigned>(parse_u64(value(), "--rounds"));
+        } else if (!std::strcmp(arg, "--threads")) {
+            opt.threads = static_cast<unsigned>(parse_u64(value(), "--threads"));
+        } else if (!std::strcmp(arg, "--target-bits")) {
+            opt.target_bits = static_cast<unsigned>(parse_u64(value(), "--target-bits"));
+        } else if (!std::strcmp(arg, "--rng-seed")) {
+            opt.rng_seed = value();
+        } else if (!std::strcmp(arg, "--solution-hex")) {
+            opt.solution_hex = value();
+        } else if (arg[0] == '-' && arg[1] == '-') {
+            usage();
+        } else {
+            opt.files.push_back(arg);
+        }
+    }
+    if (opt.rounds == 0) die("--rounds must be at least 1.");
+    if (!opt.solution_hex && opt.files.empty()) usage();
+    if (opt.threads == 0) {
+        opt.threads = std::thread::hardware_concurrency();
+        if (opt.threads == 0) opt.threads = 1;
+    }
+    if (opt.threads > opt.files.size() && !opt.files.empty()) opt.threads = static_cast<unsigned>(opt.files.size());
+    return opt;
+}
+
+// Reads up to kSolutionSize + 1 bytes so an oversized file is reported as
+// a size mismatch rather than silently truncated.
+bool read_solution(const char *path, std::vector<uint8_t> &buf) {
+    FILE *f = std::fopen(path, "rb");
+    if (!f) return false;
+    buf.resize(upow::kSolutionSize + 1);
+    size_t n = std::fread(buf.data(), 1, buf.size(), f);
+    std::fclose(f);
+    buf.resize(n);
+    return true;
+}
+
+struct Result {
+    upow::Verification v;
+    bool readable = true;
+};
+
+void print_result(const char *name, const Result &r) {
+    std::printf("{\"file\":\"%s\",\"valid\":%s,\"reason\":\"%s\",\"bits\":%u}\n", name,
+                r.readable && r.v.verdict == upow::Verdict::kOk ? "true" : "false",
+                r.readable ? upow::verdict_name(r.v.verdict) : "unreadable", r.v.bits);
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opt = parse_args(argc, argv);
+    // Each solution gets its own r vectors; --rng-seed makes a run repeatable.
+    uint64_t base_seed = opt.rng_seed ? parse_u64(opt.rng_seed, "--rng-seed")
+                                      : (static_cast<uint64_t>(std::random_device{}()) << 32) ^ std::random_device{}();
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Result> results(opt.solution_hex ? 1 : opt.files.size());
+    if (opt.solution_hex) {
+        std::vector<uint8_t> sol(std::strlen(opt.solution_hex) / 2);
+        std::vector<uint8_t> ab(upow::kABSize);
+        if (!upow::hex_to_bytes(opt.solution_hex, sol.data(), sol.size())) die("Invalid --solution-hex.");
+        results[0].v = upow::verify_solution(sol.data(), sol.size(), opt.rounds, opt.target_bits, base_seed,
+                                             ab.data());
+        print_result("-", results[0]);
+    } else {
+        std::atomic<size_t> next{0};
+        std::mutex mu;
+        auto worker = [&]() {
+            std::vector<uint8_t> ab(upow::kABSize);
+            std::vector<uint8_t> buf;
+            for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < opt.files.size();) {
+                Result &r = results[i];
+                r.readable = read_solution(opt.files[i], buf);
+                if (r.readable) {
+                    r.v = upow::verify_solution(buf.data(), buf.size(), opt.rounds, opt.target_bits,
+                                                base_seed + i * 0x9e3779b97f4a7c15ull, ab.data());
+                }
+                std::lock_guard<std::mutex> lock(mu);
+                print_result(opt.files[i], r);
+            }
+        };
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < opt.threads; ++t) pool.emplace_back(worker);
+        worker();
+        for (auto &th : pool) th.join();
+    }
+
+    size_t valid = 0;
+    for (const Result &r : results) valid += r.readable && r.v.verdict == upow::Verdict::kOk ? 1 : 0;
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+    std::printf("{\"mode\":\"upow_verify\",\"kernel\":\"%s\",\"threads\":%u,\"rounds\":%u,\"solutions\":%zu,"
+                "\"valid\":%zu,\"invalid\":%zu,\"elapsed_ms\":%.3f}\n",
+                upow::freivalds_backend(), opt.threads, opt.rounds, results.size(), valid, results.size() - valid,
+                d.count() * 1000.0);
+    std::fflush(stdout);
+    return valid == results.size() ? 0 : 1;
+}
@@ -0,0 +1,352 @@
+#include "bench.h"
+
+#include <setjmp.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#define MERKLE_HAVE_PERF 1
+#else
+#define MERKLE_HAVE_PERF 0
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "hash_lanes.h"
+#include "multiproof.h"
+
+namespace merkle {
+namespace {
+
+constexpr const char *kSchema = "merkle_bench/1";
+
+enum Counter { kCycles, kInstructions, kCacheMisses, kBranchMisses, kCounterCount };
+
+uint64_t now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+#if defined(__riscv)
+sigjmp_buf g_probe_jmp;
+
+void probe_sigill(int) {
+    siglongjmp(g_probe_jmp, 1);
+}
+
+inline uint64_t rdcycle() {
+    uint64_t c;
+    asm volatile("rdcycle %0" : "=r"(c));
+    return c;
+}
+
+// Linux 6.6+ traps user-mode rdcycle unless perf_user_access allows it.
+bool rdcycle_usable() {
+    struct sigaction sa, old;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = probe_sigill;
+    sigaction(SIGILL, &sa, &old);
+    bool ok = false;
+    if (sigsetjmp(g_probe_jmp, 1) == 0) {
+        (void)rdcycle();
+        ok = true;
+    }
+    sigaction(SIGILL, &old, nullptr);
+    return ok;
+}
+#endif
+
+// Raw cycle counter: rdtsc on x86, rdcycle on RISC-V, none elsewhere.
+struct CycleClock {
+    const char *name = "none";
+    bool ok = false;
+
+    CycleClock() {
+#if defined(__x86_64__) || defined(__i386__)
+        name = "rdtsc";
+        ok = true;
+#elif defined(__riscv)
+        if (rdcycle_usable()) {
+            name = "rdcycle";
+            ok = true;
+        }
+#endif
+    }
+
+    uint64_t read() const {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#elif defined(__riscv)
+        return ok ? rdcycle() : 0;
+#else
+        return 0;
+#endif
+    }
+};
+
+// Cycles, instructions, cache misses and branch misses of the calling
+// thread plus every thread it starts while counting (build_tree's workers),
+// folded in as they exit. inherit rules out PERF_FORMAT_GROUP reads, so the
+// four counters are opened and read separately and scaled for multiplexing.
+// Unavailable under strict perf_event_paranoid or in containers without the
+// syscall.
+class PerfCounters {
+public:
+    PerfCounters() {
+#if MERKLE_HAVE_PERF
+        static const uint64_t configs[kCounterCount] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+        };
+        for (int i = 0; i < kCounterCount; ++i) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[i];
+            attr.disabled = 1;
+            attr.inherit = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds_[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            if (fds_[i] < 0) {
+                close_all();
+                return;
+            }
+        }
+        ok_ = true;
+#endif
+    }
+
+    ~PerfCounters() { close_all(); }
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    bool ok() const { return ok_; }
+
+    void start() {
+#if MERKLE_HAVE_PERF
+        if (!ok_) return;
+        for (int fd : fds_) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    void stop(uint64_t out[kCounterCount]) {
+        std::memset(out, 0, sizeof(uint64_t) * kCounterCount);
+#if MERKLE_HAVE_PERF
+        if (!ok_) return;
+        for (int fd : fds_) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        for (int i = 0; i < kCounterCount; ++i) {
+            uint64_t buf[3];  // value, time_enabled, time_running
+            if (read(fds_[i], buf, sizeof(buf)) != static_cast<ssize_t>(sizeof(buf)) || buf[2] == 0) continue;
+            out[i] = buf[2] == buf[1] ? buf[0]
+                                      : static_cast<uint64_t>(static_cast<double>(buf[0]) *
+                                                              static_cast<double>(buf[1]) /
+                                                              static_cast<double>(buf[2]));
+        }
+#endif
+    }
+
+private:
+    void close_all() {
+        for (int &fd : fds_) {
+            if (fd >= 0) close(fd);
+            fd = -1;
+        }
+        ok_ = false;
+    }
+
+    int fds_[kCounterCount] = {-1, -1, -1, -1};
+    bool ok_ = false;
+};
+
+struct Phase {
+    const char *name;
+    size_t leaves;
+    size_t batch;
+    size_t ops;            // operations per rep (ns_per_op divides by this)
+    uint64_t hashes;       // compressions per rep, 0 when the phase hashes nothing
+};
+
+class Runner {
+public:
+    explicit Runner(const BenchConfig &cfg) : cfg_(cfg), threads_(resolve_threads(cfg.threads)) {}
+
+    // Runs fn warmup + reps times and emits one line from the timed reps.
+    template <typename Fn>
+    void measure(const Phase &ph, Fn &&fn) {
+        for (unsigned i = 0; i < cfg_.warmup; ++i) fn(i);
+        std::vector<double> ns_per_op(cfg_.reps);
+        uint64_t total_ns = 0;
+        uint64_t total_cycles = 0;
+        uint64_t totals[kCounterCount] = {};
+        for (unsigned r = 0; r < cfg_.reps; ++r) {
+            uint64_t vals[kCounterCount];
+            perf_.start();
+            uint64_t c0 = clock_.read();
+            uint64_t t0 = now_ns();
+            fn(cfg_.warmup + r);
+            uint64_t dt = now_ns() - t0;
+            uint64_t dc = clock_.read() - c0;
+            perf_.stop(vals);
+            ns_per_op[r] = static_cast<double>(dt) / static_cast<double>(ph.ops);
+            total_ns += dt;
+            total_cycles += dc;
+            for (int k = 0; k < kCounterCount; ++k) totals[k] += vals[k];
+        }
+        emit(ph, ns_per_op, total_ns, total_cycles, totals);
+    }
+
+    unsigned threads() const { return threads_; }
+
+private:
+    static double percentile(std::vector<double> &sorted, double p) {
+        if (sorted.empty()) return 0.0;
+        double rank = p * static_cast<double>(sorted.size() - 1);
+        size_t lo = static_cast<size_t>(rank);
+        size_t hi = lo + 1 < sorted.size() ? lo + 1 : lo;
+        double frac = rank - static_cast<double>(lo);
+        return sorted[lo] + (sorted[hi] - sorted[lo]) * frac;
+    }
+
+    void emit(const Phase &ph, std::vector<double> &ns_per_op, uint64_t total_ns, uint64_t total_cycles,
+              const uint64_t totals[kCounterCount]) {
+        std::sort(ns_per_op.begin(), ns_per_op.end());
+        double ops = static_cast<double>(ph.ops) * static_cast<double>(cfg_.reps);
+        double secs = static_cast<double>(total_ns) / 1e9;
+        double hps = secs > 0.0 ? static_cast<double>(ph.hashes) * cfg_.reps / secs : 0.0;
+
+        char line[1024];
+        int n = std::snprintf(
+            line, sizeof(line),
+            "{\"schema\":\"%s\",\"phase\":\"%s\",\"leaves\":%zu,\"batch\":%zu,\"threads\":%u,"
+            "\"hash_backend\":\"%s\",\"warmup\":%u,\"reps\":%u,\"ops_per_rep\":%zu,"
+            "\"ns_per_op_min\":%.1f,\"ns_per_op_p50\":%.1f,\"ns_per_op_p90\":%.1f,"
+            "\"ns_per_op_p99\":%.1f,\"ns_per_op_max\":%.1f,\"hashes_per_op\":%.3f,\"hashes_per_sec\":%.0f,"
+            "\"cycle_source\":\"%s\",\"cycles_per_op\":",
+            kSchema, ph.name, ph.leaves, ph.batch, threads_, hash_backend().name, cfg_.warmup, cfg_.reps,
+            ph.ops, ns_per_op.front(), percentile(ns_per_op, 0.50), percentile(ns_per_op, 0.90),
+            percentile(ns_per_op, 0.99), ns_per_op.back(),
+            static_cast<double>(ph.hashes) / static_cast<double>(ph.ops), hps, clock_.name);
+        n += put_opt(line + n, sizeof(line) - n, clock_.ok, static_cast<double>(total_cycles) / ops);
+        static const char *names[kCounterCount] = {"perf_cycles", "instructions", "cache_misses",
+                                                   "branch_misses"};
+        for (int k = 0; k < kCounterCount; ++k) {
+            n += std::snprintf(line + n, sizeof(line) - n, ",\"%s_per_op\":", names[k]);
+            n += put_opt(line + n, sizeof(line) - n, perf_.ok(), static_cast<double>(totals[k]) / ops);
+        }
+        n += std::snprintf(line + n, sizeof(line) - n, "}\n");
+        (void)write(cfg_.out_fd, line, static_cast<size_t>(n));
+    }
+
+    static int put_opt(char *dst, size_t cap, bool ok, double v) {
+        return ok ? std::snprintf(dst, cap, "%.2f", v) : std::snprintf(dst, cap, "null");
+    }
+
+    const BenchConfig &cfg_;
+    unsigned threads_;
+    CycleClock clock_;
+    PerfCounters perf_;
+};
+
+uint32_t bench_index(size_t i, unsigned rep, size_t leaves) {
+    return static_cast<uint32_t>(i * 2654435761u + rep) & static_cast<uint32_t>(leaves - 1);
+}
+} // namespace
+
+bool parse_size_list(const char *s, std::vector<size_t> &out) {
+    out.clear();
+    while (*s) {
+        char *end = nullptr;
+        unsigned long long v;
+        if (s[0] == '2' && s[1] == '^') {
+            v = std::strtoull(s + 2, &end, 10);
+            if (end == s + 2 || v >= 64) return false;
+            v = 1ull << v;
+        } else {
+            v = std::strtoull(s, &end, 10);
+            if (end == s) return false;
+        }
+        out.push_back(static_cast<size_t>(v));
+        if (*end == ',') {
+            s = end + 1;
+        } else if (*end == '\0') {
+            s = end;
+        } else {
+            return false;
+        }
+    }
+    return !out.empty();
+}
+
+int run_bench(const BenchConfig &cfg) {
+    Runner runner(cfg);
+    int failures = 0;
+    for (size_t leaves : cfg.leaves) {
+        Tree tree;
+        if (!tree_init(tree, cfg.seed, leaves)) return 1;
+        runner.measure({"build_tree", leaves, 0, 1, 2 * leaves - 1},
+                       [&](unsigned) { build_tree(tree, runner.threads()); });
+
+        // Index sets, proofs and multiproofs for every rep are prepared up
+        // front so each timed region covers only the phase it names.
+        unsigned rounds = cfg.warmup + cfg.reps;
+        size_t stride = kHashSize * tree.depth;
+        std::vector<uint32_t> idx;
+        std::vector<uint8_t> paths;
+        std::vector<MultiProof> multi(rounds);
+        for (size_t batch : cfg.batches) {
+            if (batch == 0) continue;
+            idx.resize(rounds * batch);
+            for (unsigned rep = 0; rep < rounds; ++rep) {
+                for (size_t i = 0; i < batch; ++i) idx[rep * batch + i] = bench_index(i, rep, leaves);
+            }
+            paths.resize(rounds * batch * stride + kHashSize);
+
+            runner.measure({"build_proof", leaves, batch, batch, 0}, [&](unsigned rep) {
+                const uint32_t *ix = idx.data() + rep * batch;
+                uint8_t *out = paths.data() + rep * batch * stride;
+                for (size_t i = 0; i < batch; ++i) build_proof(tree, ix[i], out + i * stride, tree.depth);
+            });
+            runner.measure({"verify_proof", leaves, batch, batch, batch * (tree.depth + 1)}, [&](unsigned rep) {
+                const uint32_t *ix = idx.data() + rep * batch;
+                const uint8_t *in = paths.data() + rep * batch * stride;
+                for (size_t i = 0; i < batch; ++i) {
+                    failures += verify_proof(tree, ix[i], in + i * stride, tree.depth) ? 0 : 1;
+                }
+            });
+
+            runner.measure({"build_multiproof", leaves, batch, batch, 0}, [&](unsigned rep) {
+                build_multiproof(tree, idx.data() + rep * batch, batch, multi[rep]);
+            });
+            // Compressions depend on how much the index set overlaps, so
+            // report the mean over the timed reps.
+            uint64_t multi_hashes = 0;
+            for (unsigned rep = cfg.warmup; rep < rounds; ++rep) {
+                verify_multiproof(tree.seed, tree.root(), leaves, multi[rep], &multi_hashes);
+            }
+            runner.measure({"verify_multiproof", leaves, batch, batch, multi_hashes / cfg.reps}, [&](unsigned rep) {
+                failures += verify_multiproof(tree.seed, tree.root(), leaves, multi[rep]) ? 0 : 1;
+            });
+        }
+    }
+    return failures ? 1 : 0;
+}
+
+} // namespace merkle
@@ -0,0 +1,33 @@
+#ifndef MERKLE_BENCH_H
+#define MERKLE_BENCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "tree.h"
+
+namespace merkle {
+
+struct BenchConfig {
+    std::vector<size_t> leaves;
+    std::vector<size_t> batches;
+    unsigned warmup = 2;
+    unsigned reps = 10;
+    unsigned threads = 0;
+    uint8_t seed[kSeedSize] = {};
+    int out_fd = 1;
+};
+
+// Parses "1024,65536,..." (each entry may also be written 2^k).
+bool parse_size_list(const char *s, std::vector<size_t> &out);
+
+// For every leaf count, times build_tree, then for every batch size the
+// build_proof, verify_proof, build_multiproof and verify_multiproof phases.
+// Each (phase, leaves, batch) emits one JSON line in the merkle_bench/1
+// schema; returns non-zero if any proof failed to verify.
+int run_bench(const BenchConfig &cfg);
+
+} // namespace merkle
+
+#endif /* MERKLE_BENCH_H */
@@ -0,0 +1,290 @@
+#include "hash_lanes.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "blake3.h"
+
+#ifndef MERKLE_PORTABLE_LANES
+#define MERKLE_PORTABLE_LANES 4
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(MERKLE_NO_X86_SIMD)
+#define MERKLE_HAVE_X86 1
+#else
+#define MERKLE_HAVE_X86 0
+#endif
+
+#define MERKLE_INLINE inline __attribute__((always_inline))
+
+// The lane helpers pass vectors by value but are always inlined into a
+// caller built for the matching ISA, so the psABI note does not apply.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+namespace merkle {
+namespace {
+
+constexpr size_t kHashSize = 32;
+constexpr size_t kBlockSize = 64;
+constexpr uint32_t kLeafBlockLen = 36;
+// CHUNK_START | CHUNK_END | ROOT: a one-block message hashed on its own.
+constexpr uint32_t kSingleBlockFlags = (1u << 0) | (1u << 1) | (1u << 3);
+
+constexpr uint32_t kIV[8] = {0x6A09E667u, 0xBB67AE85u, 0x3C6EF372u, 0xA54FF53Au,
+                             0x510E527Fu, 0x9B05688Cu, 0x1F83D9ABu, 0x5BE0CD19u};
+
+constexpr uint8_t kSchedule[7][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8},
+    {3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1},
+    {10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6},
+    {12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4},
+    {9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7},
+    {11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13},
+};
+
+typedef uint32_t vec_portable __attribute__((vector_size(4 * MERKLE_PORTABLE_LANES)));
+#if MERKLE_HAVE_X86
+typedef uint32_t vec_avx2 __attribute__((vector_size(32)));
+typedef uint32_t vec_avx512 __attribute__((vector_size(64)));
+#endif
+
+MERKLE_INLINE uint32_t load32(const uint8_t *p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+MERKLE_INLINE void store32(uint8_t *p, uint32_t w) {
+    p[0] = static_cast<uint8_t>(w);
+    p[1] = static_cast<uint8_t>(w >> 8);
+    p[2] = static_cast<uint8_t>(w >> 16);
+    p[3] = static_cast<uint8_t>(w >> 24);
+}
+
+template <typename V>
+MERKLE_INLINE V splat(uint32_t x) {
+    return V{} + x;
+}
+
+template <typename V>
+MERKLE_INLINE V rotr(const V &x, int c) {
+    return (x >> c) | (x << (32 - c));
+}
+
+template <typename V>
+MERKLE_INLINE void g(V s[16], int a, int b, int c, int d, const V &x, const V &y) {
+    s[a] = s[a] + s[b] + x;
+    s[d] = rotr(s[d] ^ s[a], 16);
+    s[c] = s[c] + s[d];
+    s[b] = rotr(s[b] ^ s[c], 12);
+    s[a] = s[a] + s[b] + y;
+    s[d] = rotr(s[d] ^ s[a], 8);
+    s[c] = s[c] + s[d];
+    s[b] = rotr(s[b] ^ s[c], 7);
+}
+
+// One BLAKE3 compression per lane with key = IV, counter = 0 and the
+// single-block root flags; cv receives the 32-byte output words.
+template <typename V>
+MERKLE_INLINE void compress(const V m[16], uint32_t block_len, V cv[8]) {
+    V s[16];
+    for (int i = 0; i < 8; ++i) s[i] = splat<V>(kIV[i]);
+    for (int i = 0; i < 4; ++i) s[8 + i] = splat<V>(kIV[i]);
+    s[12] = splat<V>(0);
+    s[13] = splat<V>(0);
+    s[14] = splat<V>(block_len);
+    s[15] = splat<V>(kSingleBlockFlags);
+#pragma GCC unroll 7
+    for (int r = 0; r < 7; ++r) {
+        const uint8_t *sc = kSchedule[r];
+        g(s, 0, 4, 8, 12, m[sc[0]], m[sc[1]]);
+        g(s, 1, 5, 9, 13, m[sc[2]], m[sc[3]]);
+        g(s, 2, 6, 10, 14, m[sc[4]], m[sc[5]]);
+        g(s, 3, 7, 11, 15, m[sc[6]], m[sc[7]]);
+        g(s, 0, 5, 10, 15, m[sc[8]], m[sc[9]]);
+        g(s, 1, 6, 11, 12, m[sc[10]], m[sc[11]]);
+        g(s, 2, 7, 8, 13, m[sc[12]], m[sc[13]]);
+        g(s, 3, 4, 9, 14, m[sc[14]], m[sc[15]]);
+    }
+    for (int i = 0; i < 8; ++i) cv[i] = s[i] ^ s[i + 8];
+}
+
+template <typename V>
+MERKLE_INLINE void store_lanes(const V cv[8], size_t count, uint8_t *out) {
+    for (size_t l = 0; l < count; ++l) {
+        for (int w = 0; w < 8; ++w) store32(out + l * kHashSize + 4 * w, cv[w][l]);
+    }
+}
+
+template <typename V>
+MERKLE_INLINE void parents_lanes(const uint8_t *children, size_t n, uint8_t *out) {
+    constexpr size_t kLanes = sizeof(V) / sizeof(uint32_t);
+    V m[16];
+    V cv[8];
+    size_t i = 0;
+    for (; i + kLanes <= n; i += kLanes) {
+        const uint8_t *in = children + i * kBlockSize;
+        for (int w = 0; w < 16; ++w) {
+            for (size_t l = 0; l < kLanes; ++l) m[w][l] = load32(in + l * kBlockSize + 4 * w);
+        }
+        compress(m, kBlockSize, cv);
+        store_lanes(cv, kLanes, out + i * kHashSize);
+    }
+    if (i < n) {
+        size_t rem = n - i;
+        const uint8_t *in = children + i * kBlockSize;
+        for (int w = 0; w < 16; ++w) {
+            for (size_t l = 0; l < kLanes; ++l) m[w][l] = l < rem ? load32(in + l * kBlockSize + 4 * w) : 0;
+        }
+        compress(m, kBlockSize, cv);
+        store_lanes(cv, rem, out + i * kHashSize);
+    }
+}
+
+template <typename V>
+MERKLE_INLINE void leaves_lanes(const uint8_t seed[32], uint32_t first, size_t n, uint8_t *out) {
+    constexpr size_t kLanes = sizeof(V) / sizeof(uint32_t);
+    V m[16];
+    V cv[8];
+    V iota;
+    for (size_t l = 0; l < kLanes; ++l) iota[l] = static_cast<uint32_t>(l);
+    for (int w = 0; w < 8; ++w) m[w] = splat<V>(load32(seed + 4 * w));
+    for (int w = 9; w < 16; ++w) m[w] = splat<V>(0);
+    for (size_t i = 0; i < n; i += kLanes) {
+        m[8] = iota + static_cast<uint32_t>(first + i);
+        compress(m, kLeafBlockLen, cv);
+        store_lanes(cv, n - i < kLanes ? n - i : kLanes, out + i * kHashSize);
+    }
+}
+
+template <typename V>
+MERKLE_INLINE void leaves_list_lanes(const uint8_t seed[32], const uint32_t *idx, size_t n, uint8_t *out) {
+    constexpr size_t kLanes = sizeof(V) / sizeof(uint32_t);
+    V m[16];
+    V cv[8];
+    for (int w = 0; w < 8; ++w) m[w] = splat<V>(load32(seed + 4 * w));
+    for (int w = 9; w < 16; ++w) m[w] = splat<V>(0);
+    for (size_t i = 0; i < n; i += kLanes) {
+        size_t count = n - i < kLanes ? n - i : kLanes;
+        for (size_t l = 0; l < kLanes; ++l) m[8][l] = l < count ? idx[i + l] : 0;
+        compress(m, kLeafBlockLen, cv);
+        store_lanes(cv, count, out + i * kHashSize);
+    }
+}
+
+void parents_scalar(const uint8_t *children, size_t n, uint8_t *out) {
+    for (size_t i = 0; i < n; ++i) {
+        blake3_hasher h;
+        blake3_hasher_init(&h);
+        blake3_hasher_update(&h, children + i * kBlockSize, kBlockSize);
+        blake3_hasher_finalize(&h, out + i * kHashSize, kHashSize);
+    }
+}
+
+void leaves_scalar(const uint8_t seed[32], uint32_t first, size_t n, uint8_t *out) {
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t idx = first + static_cast<uint32_t>(i);
+        uint8_t idx_bytes[4];
+        store32(idx_bytes, idx);
+        blake3_hasher h;
+        blake3_hasher_init(&h);
+        blake3_hasher_update(&h, seed, 32);
+        blake3_hasher_update(&h, idx_bytes, sizeof(idx_bytes));
+        blake3_hasher_finalize(&h, out + i * kHashSize, kHashSize);
+    }
+}
+
+void leaves_list_scalar(const uint8_t seed[32], const uint32_t *idx, size_t n, uint8_t *out) {
+    for (size_t i = 0; i < n; ++i) leaves_scalar(seed, idx[i], 1, out + i * kHashSize);
+}
+
+void parents_portable(const uint8_t *children, size_t n, uint8_t *out) {
+    parents_lanes<vec_portable>(children, n, out);
+}
+
+void leaves_portable(const uint8_t seed[32], uint32_t first, size_t n, uint8_t *out) {
+    leaves_lanes<vec_portable>(seed, first, n, out);
+}
+
+void leaves_list_portable(const uint8_t seed[32], const uint32_t *idx, size_t n, uint8_t *out) {
+    leaves_list_lanes<vec_portable>(seed, idx, n, out);
+}
+
+#if MERKLE_HAVE_X86
+__attribute__((target("avx2")))
+void parents_avx2(const uint8_t *children, size_t n, uint8_t *out) {
+    parents_lanes<vec_avx2>(children, n, out);
+}
+
+__attribute__((target("avx2")))
+void leaves_avx2(const uint8_t seed[32], uint32_t first, size_t n, uint8_t *out) {
+    leaves_lanes<vec_avx2>(seed, first, n, out);
+}
+
+__attribute__((target("avx2")))
+void leaves_list_avx2(const uint8_t seed[32], const uint32_t *idx, size_t n, uint8_t *out) {
+    leaves_list_lanes<vec_avx2>(seed, idx, n, out);
+}
+
+__attribute__((target("avx512f")))
+void parents_avx512(const uint8_t *children, size_t n, uint8_t *out) {
+    parents_lanes<vec_avx512>(children, n, out);
+}
+
+__attribute__((target("avx512f")))
+void leaves_avx512(const uint8_t seed[32], uint32_t first, size_t n, uint8_t *out) {
+    leaves_lanes<vec_avx512>(seed, first, n, out);
+}
+
+__attribute__((target("avx512f")))
+void leaves_list_avx512(const uint8_t seed[32], const uint32_t *idx, size_t n, uint8_t *out) {
+    leaves_list_lanes<vec_avx512>(seed, idx, n, out);
+}
+#endif
+
+const HashBackend kBackends[] = {
+#if MERKLE_HAVE_X86
+    {"avx512", 16, parents_avx512, leaves_avx512, leaves_list_avx512},
+    {"avx2", 8, parents_avx2, leaves_avx2, leaves_list_avx2},
+#endif
+    {"portable", MERKLE_PORTABLE_LANES, parents_portable, leaves_portable, leaves_list_portable},
+    {"scalar", 1, parents_scalar, leaves_scalar, leaves_list_scalar},
+};
+
+bool backend_supported(const HashBackend &b) {
+#if MERKLE_HAVE_X86
+    if (!std::strcmp(b.name, "avx512")) return __builtin_cpu_supports("avx512f");
+    if (!std::strcmp(b.name, "avx2")) return __builtin_cpu_supports("avx2");
+#endif
+    (void)b;
+    return true;
+}
+
+const HashBackend &select_backend() {
+    const char *want = std::getenv("MERKLE_HASH_BACKEND");
+    if (want && *want && std::strcmp(want, "auto") != 0) {
+        for (const HashBackend &b : kBackends) {
+            if (!std::strcmp(b.name, want) && backend_supported(b)) return b;
+        }
+        std::fprintf(stderr, "MERKLE_HASH_BACKEND=%s unavailable, using auto\n", want);
+    }
+    for (const HashBackend &b : kBackends) {
+        if (backend_supported(b)) return b;
+    }
+    return kBackends[sizeof(kBackends) / sizeof(kBackends[0]) - 1];
+}
+} // namespace
+
+const HashBackend &hash_backend() {
+    static const HashBackend &backend = select_backend();
+    return backend;
+}
+
+const HashBackend &scalar_backend() {
+    return kBackends[sizeof(kBackends) / sizeof(kBackends[0]) - 1];
+}
+
+} // namespace merkle
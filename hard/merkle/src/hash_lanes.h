@@ -0,0 +1,40 @@
+#ifndef MERKLE_HASH_LANES_H
+#define MERKLE_HASH_LANES_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace merkle {
+
+// Every Merkle leaf (seed || idx, 36 bytes) and parent (left || right, 64
+// bytes) is a single BLAKE3 block hashed as a root chunk, so a whole tree
+// level can go through one multi-lane compression call.
+struct HashBackend {
+    const char *name;
+    size_t lanes;
+    // out[i] = blake3(children[64 * i .. 64 * i + 64]) for i < n.
+    void (*parents)(const uint8_t *children, size_t n, uint8_t *out);
+    // out[i] = blake3(seed || le32(first + i)) for i < n.
+    void (*leaves)(const uint8_t seed[32], uint32_t first, size_t n, uint8_t *out);
+    // out[i] = blake3(seed || le32(idx[i])) for i < n.
+    void (*leaves_list)(const uint8_t seed[32], const uint32_t *idx, size_t n, uint8_t *out);
+};
+
+// Widest backend the CPU supports, resolved once. MERKLE_HASH_BACKEND in the
+// environment forces one by name (scalar, portable, avx2, avx512).
+const HashBackend &hash_backend();
+
+// One blake3_hasher per input; no lane setup or transpose.
+const HashBackend &scalar_backend();
+
+// A lane call costs about the same whatever its fill, roughly two scalar
+// compressions on AVX2/AVX-512, so batches below this go to the scalar one.
+constexpr size_t kLaneMinBatch = 2;
+
+inline const HashBackend &hash_backend_for(size_t n) {
+    return n < kLaneMinBatch ? scalar_backend() : hash_backend();
+}
+
+} // namespace merkle
+
+#endif /* MERKLE_HASH_LANES_H */
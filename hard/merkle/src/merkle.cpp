@@ -1,9 +1,19 @@
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <ctime>
+#include <fcntl.h>
 #include <unistd.h>
+#include <vector>
 
-#include "blake3.h"
+#include "bench.h"
+#include "hash_lanes.h"
+#include "multiproof.h"
+#include "server.h"
+#include "snapshot.h"
+#include "stream.h"
+#include "tree.h"
 
 #ifndef MERKLE_LEAVES
 #define MERKLE_LEAVES 1024
@@ -17,22 +27,50 @@
 #define MERKLE_ITERS 1
 #endif
 
+#ifndef MERKLE_THREADS
+#define MERKLE_THREADS 0
+#endif
+
 #ifndef MERKLE_PROGRESS
 #define MERKLE_PROGRESS 0
 #endif
 
+#ifndef MERKLE_RECORD_SIZE
+#define MERKLE_RECORD_SIZE 4096
+#endif
+
 #ifndef MERKLE_SEED_HEX
 #define MERKLE_SEED_HEX "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
 #endif
 
 namespace {
-constexpr size_t kHashSize = 32;
-constexpr size_t kSeedSize = 32;
-constexpr size_t kTotalNodes = 2 * MERKLE_LEAVES - 1;
-constexpr size_t kLeafBase = MERKLE_LEAVES - 1;
+using merkle::kHashSize;
+using merkle::kSeedSize;
 
-uint8_t g_tree[kTotalNodes * kHashSize];
-uint8_t g_seed[kSeedSize];
+struct Options {
+    uint64_t leaves = MERKLE_LEAVES;
+    uint64_t proofs = MERKLE_PROOFS;
+    uint64_t iters = MERKLE_ITERS;
+    uint64_t threads = MERKLE_THREADS;
+    uint64_t updates = 0;
+    bool multiproof = false;
+    bool bench = false;
+    uint64_t warmup = 2;
+    uint64_t reps = 10;
+    const char *bench_leaves = "2^10,2^14,2^18,2^20";
+    const char *bench_batches = "1,16,64";
+    const char *bench_out = nullptr;
+    const char *input = nullptr;
+    uint64_t record_size = MERKLE_RECORD_SIZE;
+    const char *prove = nullptr;
+    const char *snapshot = nullptr;
+    const char *snapshot_out = nullptr;
+    const char *serve = nullptr;
+    const char *loadgen = nullptr;
+    uint64_t clients = 4;
+    uint64_t requests = 1000;
+    uint64_t batch = 16;
+};
 
 int hex_val(char c) {
     if (c >= '0' && c <= '9') return c - '0';
@@ -70,96 +108,489 @@ static size_t u64_to_dec(char *dst, uint64_t value) {
     return pos;
 }
 
-inline uint8_t *node_ptr(size_t idx) {
-    return g_tree + idx * kHashSize;
+void put_str(char *buf, size_t &pos, const char *s) {
+    size_t n = std::strlen(s);
+    std::memcpy(buf + pos, s, n);
+    pos += n;
+}
+
+void put_u64(char *buf, size_t &pos, uint64_t v) {
+    pos += u64_to_dec(buf + pos, v);
 }
 
-void hash_leaf(uint32_t idx, uint8_t out[kHashSize]) {
-    blake3_hasher h;
-    blake3_hasher_init(&h);
-    blake3_hasher_update(&h, g_seed, sizeof(g_seed));
-    uint8_t idx_bytes[4] = {
-        static_cast<uint8_t>(idx & 0xff),
-        static_cast<uint8_t>((idx >> 8) & 0xff),
-        static_cast<uint8_t>((idx >> 16) & 0xff),
-        static_cast<uint8_t>((idx >> 24) & 0xff),
-    };
-    blake3_hasher_update(&h, idx_bytes, sizeof(idx_bytes));
-    blake3_hasher_finalize(&h, out, kHashSize);
+void put_hex(char *buf, size_t &pos, const uint8_t *bytes, size_t len) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; ++i) {
+        buf[pos++] = digits[bytes[i] >> 4];
+        buf[pos++] = digits[bytes[i] & 0x0f];
+    }
 }
 
-void hash_node(const uint8_t *left, const uint8_t *right, uint8_t out[kHashSize]) {
-    blake3_hasher h;
-    blake3_hasher_init(&h);
-    blake3_hasher_update(&h, left, kHashSize);
-    blake3_hasher_update(&h, right, kHashSize);
-    blake3_hasher_finalize(&h, out, kHashSize);
+void fail(const char *msg) {
+    (void)write(2, msg, std::strlen(msg));
+    std::exit(1);
+}
+
+bool parse_u64(const char *s, uint64_t &out) {
+    char *end = nullptr;
+    unsigned long long v = std::strtoull(s, &end, 0);
+    if (!s[0] || *end != '\0') return false;
+    out = static_cast<uint64_t>(v);
+    return true;
+}
+
+Options parse_args(int argc, char **argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        uint64_t *dst = nullptr;
+        if (!std::strcmp(arg, "--multiproof")) {
+            opt.multiproof = true;
+            continue;
+        }
+        if (!std::strcmp(arg, "--bench")) {
+            opt.bench = true;
+            continue;
+        }
+        const char **str = nullptr;
+        if (!std::strcmp(arg, "--bench-leaves")) {
+            str = &opt.bench_leaves;
+        } else if (!std::strcmp(arg, "--bench-batches")) {
+            str = &opt.bench_batches;
+        } else if (!std::strcmp(arg, "--bench-out")) {
+            str = &opt.bench_out;
+        } else if (!std::strcmp(arg, "--input")) {
+            str = &opt.input;
+        } else if (!std::strcmp(arg, "--prove")) {
+            str = &opt.prove;
+        } else if (!std::strcmp(arg, "--snapshot")) {
+            str = &opt.snapshot;
+        } else if (!std::strcmp(arg, "--snapshot-out")) {
+            str = &opt.snapshot_out;
+        } else if (!std::strcmp(arg, "--serve")) {
+            str = &opt.serve;
+        } else if (!std::strcmp(arg, "--loadgen")) {
+            str = &opt.loadgen;
+        }
+        if (str && i + 1 < argc) {
+            *str = argv[++i];
+            continue;
+        }
+        if (!std::strcmp(arg, "--leaves")) {
+            dst = &opt.leaves;
+        } else if (!std::strcmp(arg, "--proofs")) {
+            dst = &opt.proofs;
+        } else if (!std::strcmp(arg, "--iters")) {
+            dst = &opt.iters;
+        } else if (!std::strcmp(arg, "--threads")) {
+            dst = &opt.threads;
+        } else if (!std::strcmp(arg, "--update")) {
+            dst = &opt.updates;
+        } else if (!std::strcmp(arg, "--warmup")) {
+            dst = &opt.warmup;
+        } else if (!std::strcmp(arg, "--reps")) {
+            dst = &opt.reps;
+        } else if (!std::strcmp(arg, "--record-size")) {
+            dst = &opt.record_size;
+        } else if (!std::strcmp(arg, "--clients")) {
+            dst = &opt.clients;
+        } else if (!std::strcmp(arg, "--requests")) {
+            dst = &opt.requests;
+        } else if (!std::strcmp(arg, "--batch")) {
+            dst = &opt.batch;
+        }
+        if (!dst || i + 1 >= argc || !parse_u64(argv[++i], *dst)) {
+            fail("usage: merkle [--leaves N] [--proofs N] [--iters N] [--threads N] [--multiproof]\n"
+                 "              [--update K]\n"
+                 "       merkle --bench [--bench-leaves LIST] [--bench-batches LIST] [--warmup N]\n"
+                 "              [--reps N] [--threads N] [--bench-out PATH]\n"
+                 "       merkle --input PATH|- [--record-size N] [--prove I,J,...] [--threads N]\n"
+                 "       merkle --leaves N --snapshot-out PATH\n"
+                 "       merkle --snapshot PATH [--proofs N] [--iters N]\n"
+                 "       merkle --snapshot PATH --serve SOCKET\n"
+                 "       merkle --snapshot PATH --loadgen SOCKET [--clients N] [--requests N] [--batch N]\n");
+        }
+    }
+    // total_proofs is reported as proofs * iters.
+    if (opt.iters != 0 && opt.proofs > UINT64_MAX / opt.iters) fail("--proofs * --iters overflows 64 bits\n");
+    return opt;
+}
+
+// Leaf proved as proof i of iteration iter; the 32-bit wrap of the
+// multiplicative hash is part of the checksum every mode reproduces.
+uint32_t proof_index(uint64_t i, uint64_t iter, uint32_t mask) {
+    return (static_cast<uint32_t>(i) * 2654435761u + static_cast<uint32_t>(iter)) & mask;
+}
+
+uint64_t now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// --update K: `iters` rounds that each rehash K pseudo-random leaves and
+// only their dirty paths, against the same number of full rebuilds. Both
+// sides include leaf hashing so the speedup compares like with like.
+int run_update_bench(const Options &opt, merkle::Tree &tree, unsigned threads) {
+    uint64_t rounds = opt.iters ? opt.iters : 1;
+    uint64_t rebuild_ns = 0;
+    for (uint64_t r = 0; r < rounds; ++r) {
+        uint64_t t0 = now_ns();
+        merkle::build_tree(tree, threads);
+        rebuild_ns += now_ns() - t0;
+    }
+
+    const merkle::HashBackend &hb = merkle::hash_backend();
+    std::vector<uint32_t> idx(opt.updates);
+    std::vector<uint8_t> values(opt.updates * kHashSize);
+    std::vector<uint8_t> path(kHashSize * tree.depth + kHashSize);
+    uint8_t round_seed[kSeedSize];
+    uint32_t mask = static_cast<uint32_t>(opt.leaves - 1);
+    uint64_t update_ns = 0;
+    uint64_t update_hashes = 0;
+    uint64_t proofs_ok = 0;
+    for (uint64_t r = 0; r < rounds; ++r) {
+        std::memcpy(round_seed, tree.seed, kSeedSize);
+        round_seed[0] ^= static_cast<uint8_t>(r + 1);
+        round_seed[1] ^= static_cast<uint8_t>((r + 1) >> 8);
+        for (uint64_t i = 0; i < opt.updates; ++i) {
+            idx[i] = static_cast<uint32_t>(i * 2654435761u + r * 40503u) & mask;
+        }
+
+        uint64_t t0 = now_ns();
+        hb.leaves_list(round_seed, idx.data(), idx.size(), values.data());
+        if (!merkle::update_leaves(tree, idx.data(), values.data(), idx.size(), &update_hashes)) {
+            fail("Update index out of range\n");
+        }
+        update_ns += now_ns() - t0;
+        update_hashes += idx.size();
+
+        // Proofs taken after the update must verify against the new root.
+        for (uint64_t i = 0; i < opt.updates; ++i) {
+            const uint8_t *leaf = tree.node(tree.leaf_base + idx[i]);
+            size_t depth = merkle::build_proof(tree, idx[i], path.data(), tree.depth);
+            proofs_ok += merkle::verify_path(tree.root(), idx[i], leaf, path.data(), depth) ? 1 : 0;
+        }
+    }
+
+    uint8_t root[kHashSize];
+    std::memcpy(root, tree.root(), kHashSize);
+    merkle::rehash_parents(tree, threads);
+    bool consistent = std::memcmp(root, tree.root(), kHashSize) == 0;
+
+    char buf[512];
+    size_t pos = 0;
+    put_str(buf, pos, "{\"mode\":\"merkle_update\",\"leaves\":");
+    put_u64(buf, pos, opt.leaves);
+    put_str(buf, pos, ",\"updates\":");
+    put_u64(buf, pos, opt.updates);
+    put_str(buf, pos, ",\"rounds\":");
+    put_u64(buf, pos, rounds);
+    put_str(buf, pos, ",\"update_ns\":");
+    put_u64(buf, pos, update_ns / rounds);
+    put_str(buf, pos, ",\"update_hashes\":");
+    put_u64(buf, pos, update_hashes / rounds);
+    put_str(buf, pos, ",\"rebuild_ns\":");
+    put_u64(buf, pos, rebuild_ns / rounds);
+    put_str(buf, pos, ",\"rebuild_hashes\":");
+    put_u64(buf, pos, 2 * opt.leaves - 1);
+    put_str(buf, pos, ",\"proofs_ok\":");
+    put_u64(buf, pos, proofs_ok);
+    put_str(buf, pos, ",\"consistent\":");
+    put_str(buf, pos, consistent ? "true" : "false");
+    put_str(buf, pos, ",\"hash_backend\":\"");
+    put_str(buf, pos, hb.name);
+    put_str(buf, pos, "\",\"threads\":");
+    put_u64(buf, pos, threads);
+    put_str(buf, pos, ",\"root\":\"");
+    put_hex(buf, pos, root, kHashSize);
+    buf[pos++] = '"';
+    buf[pos++] = '}';
+    buf[pos++] = '\n';
+    (void)write(1, buf, pos);
+    return consistent && proofs_ok == rounds * opt.updates ? 0 : 1;
 }
 
-bool is_power_of_two(size_t v) {
-    return v && ((v & (v - 1)) == 0);
+bool parse_index_list(const char *s, std::vector<uint32_t> &out) {
+    char tmp[32];
+    while (*s) {
+        size_t n = std::strcspn(s, ",");
+        uint64_t v;
+        if (n == 0 || n >= sizeof(tmp)) return false;
+        std::memcpy(tmp, s, n);
+        tmp[n] = '\0';
+        if (!parse_u64(tmp, v) || v >= merkle::kMaxLeaves) return false;
+        out.push_back(static_cast<uint32_t>(v));
+        s += n;
+        if (*s == ',') ++s;
+    }
+    return true;
 }
 
-void build_tree() {
-    for (size_t i = 0; i < MERKLE_LEAVES; ++i) {
-        hash_leaf(static_cast<uint32_t>(i), node_ptr(kLeafBase + i));
+// --input: root over a file or pipe cut into --record-size records, streamed
+// through StreamTree, plus one merkle_stream_proof line per --prove index.
+int run_stream(const Options &opt) {
+    std::vector<uint32_t> targets;
+    if (opt.prove && !parse_index_list(opt.prove, targets)) fail("Invalid --prove\n");
+    if (opt.record_size == 0) fail("--record-size must be at least 1\n");
+    int fd = std::strcmp(opt.input, "-") ? open(opt.input, O_RDONLY) : 0;
+    if (fd < 0) fail("Failed to open --input\n");
+
+    unsigned threads = merkle::resolve_threads(static_cast<unsigned>(opt.threads));
+    merkle::StreamTree st(targets);
+    merkle::StreamStats stats;
+    uint64_t t0 = now_ns();
+    if (!merkle::stream_records(fd, opt.record_size, threads, st, stats)) fail("Failed to read --input\n");
+    if (!st.finish()) fail("Empty input or --prove index past the last record\n");
+    uint64_t elapsed = now_ns() - t0;
+    if (fd != 0) close(fd);
+
+    uint64_t proofs_ok = 0;
+    for (size_t i = 0; i < st.targets().size(); ++i) {
+        proofs_ok += merkle::verify_path(st.root(), st.targets()[i], st.leaf(i), st.path(i), st.depth()) ? 1 : 0;
     }
-    for (size_t i = kLeafBase; i-- > 0;) {
-        hash_node(node_ptr(2 * i + 1), node_ptr(2 * i + 2), node_ptr(i));
+
+    char buf[512];
+    size_t pos = 0;
+    put_str(buf, pos, "{\"mode\":\"merkle_stream\",\"source\":\"");
+    put_str(buf, pos, stats.mapped ? "mmap" : "read");
+    put_str(buf, pos, "\",\"bytes\":");
+    put_u64(buf, pos, stats.bytes);
+    put_str(buf, pos, ",\"record_size\":");
+    put_u64(buf, pos, opt.record_size);
+    put_str(buf, pos, ",\"leaves\":");
+    put_u64(buf, pos, st.leaves());
+    put_str(buf, pos, ",\"padded_leaves\":");
+    put_u64(buf, pos, st.padded_leaves());
+    put_str(buf, pos, ",\"depth\":");
+    put_u64(buf, pos, st.depth());
+    put_str(buf, pos, ",\"node_hashes\":");
+    put_u64(buf, pos, st.node_hashes());
+    put_str(buf, pos, ",\"elapsed_ns\":");
+    put_u64(buf, pos, elapsed);
+    put_str(buf, pos, ",\"proofs\":");
+    put_u64(buf, pos, st.targets().size());
+    put_str(buf, pos, ",\"proofs_ok\":");
+    put_u64(buf, pos, proofs_ok);
+    put_str(buf, pos, ",\"hash_backend\":\"");
+    put_str(buf, pos, merkle::hash_backend().name);
+    put_str(buf, pos, "\",\"threads\":");
+    put_u64(buf, pos, threads);
+    put_str(buf, pos, ",\"root\":\"");
+    put_hex(buf, pos, st.root(), kHashSize);
+    put_str(buf, pos, "\"}\n");
+    (void)write(1, buf, pos);
+
+    std::vector<char> line(256 + (merkle::kMaxDepth + 1) * (2 * kHashSize + 3));
+    for (size_t i = 0; i < st.targets().size(); ++i) {
+        pos = 0;
+        put_str(line.data(), pos, "{\"mode\":\"merkle_stream_proof\",\"index\":");
+        put_u64(line.data(), pos, st.targets()[i]);
+        put_str(line.data(), pos, ",\"leaf\":\"");
+        put_hex(line.data(), pos, st.leaf(i), kHashSize);
+        put_str(line.data(), pos, "\",\"path\":[");
+        for (size_t d = 0; d < st.depth(); ++d) {
+            put_str(line.data(), pos, d ? ",\"" : "\"");
+            put_hex(line.data(), pos, st.path(i) + d * kHashSize, kHashSize);
+            line[pos++] = '"';
+        }
+        put_str(line.data(), pos, "]}\n");
+        (void)write(1, line.data(), pos);
     }
+    return proofs_ok == st.targets().size() ? 0 : 1;
 }
 
-size_t build_proof(uint32_t leaf_idx, uint8_t *path, size_t max_path) {
-    size_t node = kLeafBase + leaf_idx;
-    size_t depth = 0;
-    while (node > 0 && depth + 1 <= max_path) {
-        size_t sibling = (node % 2 == 0) ? node - 1 : node + 1;
-        std::memcpy(path + depth * kHashSize, node_ptr(sibling), kHashSize);
-        node = (node - 1) / 2;
-        depth++;
+// --snapshot PATH: proof loop against a mapped snapshot, with the same
+// checksum as the in-memory run over the same leaves.
+int run_snapshot_proofs(const Options &opt, const merkle::Snapshot &snap, uint64_t load_ns) {
+    std::vector<uint8_t> path(kHashSize * snap.depth() + kHashSize);
+    uint8_t leaf[kHashSize];
+    uint64_t checksum = 0;
+    uint32_t mask = static_cast<uint32_t>(snap.leaves() - 1);
+    uint64_t t0 = now_ns();
+    for (uint64_t iter = 0; iter < opt.iters; ++iter) {
+        for (uint64_t i = 0; i < opt.proofs; ++i) {
+            uint32_t idx = proof_index(i, iter, mask);
+            size_t depth = snap.build_proof(idx, path.data());
+            merkle::hash_leaf(snap.seed(), idx, leaf);
+            checksum += merkle::verify_path(snap.root(), idx, leaf, path.data(), depth) ? 1 : 0;
+            checksum += snap.root()[0];
+        }
     }
-    return depth;
+    uint64_t proof_ns = now_ns() - t0;
+
+    char buf[512];
+    size_t pos = 0;
+    put_str(buf, pos, "{\"mode\":\"merkle_snapshot\",\"leaves\":");
+    put_u64(buf, pos, snap.leaves());
+    put_str(buf, pos, ",\"proofs\":");
+    put_u64(buf, pos, opt.proofs);
+    put_str(buf, pos, ",\"iters\":");
+    put_u64(buf, pos, opt.iters);
+    put_str(buf, pos, ",\"total_proofs\":");
+    put_u64(buf, pos, opt.proofs * opt.iters);
+    put_str(buf, pos, ",\"checksum\":");
+    put_u64(buf, pos, checksum);
+    put_str(buf, pos, ",\"load_ns\":");
+    put_u64(buf, pos, load_ns);
+    put_str(buf, pos, ",\"proof_ns\":");
+    put_u64(buf, pos, proof_ns);
+    put_str(buf, pos, ",\"root\":\"");
+    put_hex(buf, pos, snap.root(), kHashSize);
+    put_str(buf, pos, "\"}\n");
+    (void)write(1, buf, pos);
+    return 0;
 }
 
-bool verify_proof(uint32_t leaf_idx, const uint8_t *path, size_t depth) {
-    uint8_t cur[kHashSize];
-    uint8_t tmp[kHashSize];
-    hash_leaf(leaf_idx, cur);
+int run_serve(const merkle::Snapshot &snap, const char *socket_path) {
+    merkle::ServerStats stats;
+    if (!merkle::serve(snap, socket_path, stats)) fail("Failed to listen on --serve socket\n");
+    char buf[256];
+    size_t pos = 0;
+    put_str(buf, pos, "{\"mode\":\"merkle_serve\",\"requests\":");
+    put_u64(buf, pos, stats.requests);
+    put_str(buf, pos, ",\"proofs\":");
+    put_u64(buf, pos, stats.proofs);
+    put_str(buf, pos, ",\"batches\":");
+    put_u64(buf, pos, stats.batches);
+    put_str(buf, pos, ",\"max_batch\":");
+    put_u64(buf, pos, stats.max_batch);
+    put_str(buf, pos, "}\n");
+    (void)write(1, buf, pos);
+    return 0;
+}
+
+int run_loadgen(const Options &opt, const merkle::Snapshot &snap) {
+    if (opt.batch == 0 || opt.batch > merkle::kMaxRequestProofs) fail("--batch must be in 1..4096\n");
+    merkle::LoadConfig cfg;
+    cfg.socket_path = opt.loadgen;
+    cfg.clients = static_cast<unsigned>(opt.clients);
+    cfg.requests = opt.requests;
+    cfg.batch = static_cast<uint32_t>(opt.batch);
+    merkle::LoadResult res;
+    bool ok = merkle::run_load(snap, cfg, res);
+    double secs = static_cast<double>(res.elapsed_ns) / 1e9;
+
+    char buf[512];
+    size_t pos = 0;
+    put_str(buf, pos, "{\"mode\":\"merkle_loadgen\",\"clients\":");
+    put_u64(buf, pos, cfg.clients);
+    put_str(buf, pos, ",\"batch\":");
+    put_u64(buf, pos, cfg.batch);
+    put_str(buf, pos, ",\"requests\":");
+    put_u64(buf, pos, res.requests);
+    put_str(buf, pos, ",\"proofs\":");
+    put_u64(buf, pos, res.proofs);
+    put_str(buf, pos, ",\"elapsed_ns\":");
+    put_u64(buf, pos, res.elapsed_ns);
+    put_str(buf, pos, ",\"requests_per_sec\":");
+    put_u64(buf, pos, secs > 0 ? static_cast<uint64_t>(res.requests / secs) : 0);
+    put_str(buf, pos, ",\"proofs_per_sec\":");
+    put_u64(buf, pos, secs > 0 ? static_cast<uint64_t>(res.proofs / secs) : 0);
+    put_str(buf, pos, ",\"p50_ns\":");
+    put_u64(buf, pos, res.p50_ns);
+    put_str(buf, pos, ",\"p90_ns\":");
+    put_u64(buf, pos, res.p90_ns);
+    put_str(buf, pos, ",\"p99_ns\":");
+    put_u64(buf, pos, res.p99_ns);
+    put_str(buf, pos, ",\"max_ns\":");
+    put_u64(buf, pos, res.max_ns);
+    put_str(buf, pos, ",\"verified\":");
+    put_u64(buf, pos, res.verified);
+    put_str(buf, pos, ",\"verified_ok\":");
+    put_u64(buf, pos, res.verified_ok);
+    put_str(buf, pos, "}\n");
+    (void)write(1, buf, pos);
+    return ok && res.verified_ok == res.verified ? 0 : 1;
+}
 
-    size_t node = kLeafBase + leaf_idx;
-    for (size_t i = 0; i < depth; ++i) {
-        const uint8_t *sib = path + i * kHashSize;
-        if (node % 2 == 1) {
-            hash_node(cur, sib, tmp);
-        } else {
-            hash_node(sib, cur, tmp);
+int run_snapshot(const Options &opt) {
+    merkle::Snapshot snap;
+    uint64_t t0 = now_ns();
+    if (!snap.open(opt.snapshot)) fail("Failed to open --snapshot (missing, truncated or wrong version)\n");
+    uint64_t load_ns = now_ns() - t0;
+    if (opt.serve) return run_serve(snap, opt.serve);
+    if (opt.loadgen) return run_loadgen(opt, snap);
+    return run_snapshot_proofs(opt, snap, load_ns);
+}
+
+// --bench: per-phase timing sweeps, one merkle_bench/1 JSON line per
+// (phase, leaves, batch).
+int run_phase_bench(const Options &opt, const uint8_t seed[kSeedSize]) {
+    merkle::BenchConfig cfg;
+    if (!merkle::parse_size_list(opt.bench_leaves, cfg.leaves)) fail("Invalid --bench-leaves\n");
+    if (!merkle::parse_size_list(opt.bench_batches, cfg.batches)) fail("Invalid --bench-batches\n");
+    for (size_t n : cfg.leaves) {
+        if (!merkle::is_power_of_two(n) || n > merkle::kMaxLeaves) {
+            fail("bench leaves must be powers of two <= 2^31\n");
         }
-        std::memcpy(cur, tmp, kHashSize);
-        node = (node - 1) / 2;
     }
-    return std::memcmp(cur, node_ptr(0), kHashSize) == 0;
+    if (opt.reps == 0) fail("--reps must be at least 1\n");
+    cfg.warmup = static_cast<unsigned>(opt.warmup);
+    cfg.reps = static_cast<unsigned>(opt.reps);
+    cfg.threads = static_cast<unsigned>(opt.threads);
+    std::memcpy(cfg.seed, seed, kSeedSize);
+    if (opt.bench_out) {
+        cfg.out_fd = open(opt.bench_out, O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (cfg.out_fd < 0) fail("Failed to open --bench-out\n");
+    }
+    int rc = merkle::run_bench(cfg);
+    if (opt.bench_out) close(cfg.out_fd);
+    return rc;
 }
 } // namespace
 
-int main() {
-    if (!is_power_of_two(MERKLE_LEAVES)) {
-        const char msg[] = "MERKLE_LEAVES must be power of two\n";
-        (void)write(2, msg, sizeof(msg) - 1);
-        return 1;
+int main(int argc, char **argv) {
+    Options opt = parse_args(argc, argv);
+    if (!merkle::is_power_of_two(opt.leaves) || opt.leaves > merkle::kMaxLeaves) {
+        fail("leaves must be a power of two <= 2^31\n");
     }
-    if (!hex_to_bytes(MERKLE_SEED_HEX, g_seed, sizeof(g_seed))) {
-        const char msg[] = "Invalid MERKLE_SEED_HEX\n";
-        (void)write(2, msg, sizeof(msg) - 1);
-        return 1;
+    uint8_t seed[kSeedSize];
+    if (!hex_to_bytes(MERKLE_SEED_HEX, seed, sizeof(seed))) {
+        fail("Invalid MERKLE_SEED_HEX\n");
     }
+    if (opt.bench) return run_phase_bench(opt, seed);
+    if (opt.input) return run_stream(opt);
+    if (opt.snapshot) return run_snapshot(opt);
 
-    build_tree();
+    merkle::Tree tree;
+    if (!merkle::tree_init(tree, seed, opt.leaves)) {
+        fail("Failed to allocate tree storage\n");
+    }
+    unsigned threads = merkle::resolve_threads(static_cast<unsigned>(opt.threads));
+    if (opt.updates) return run_update_bench(opt, tree, threads);
+    uint64_t build_start = now_ns();
+    merkle::build_tree(tree, threads);
+    if (opt.snapshot_out) {
+        uint64_t build_ns = now_ns() - build_start;
+        uint64_t t0 = now_ns();
+        if (!merkle::write_snapshot(tree, opt.snapshot_out)) fail("Failed to write --snapshot-out\n");
+        uint64_t write_ns = now_ns() - t0;
+        char buf[256];
+        size_t pos = 0;
+        put_str(buf, pos, "{\"mode\":\"merkle_snapshot_write\",\"leaves\":");
+        put_u64(buf, pos, opt.leaves);
+        put_str(buf, pos, ",\"build_ns\":");
+        put_u64(buf, pos, build_ns);
+        put_str(buf, pos, ",\"write_ns\":");
+        put_u64(buf, pos, write_ns);
+        put_str(buf, pos, ",\"root\":\"");
+        put_hex(buf, pos, tree.root(), kHashSize);
+        put_str(buf, pos, "\"}\n");
+        (void)write(1, buf, pos);
+        return 0;
+    }
 
-    uint8_t path[32 * 20];
+    std::vector<uint8_t> path(kHashSize * tree.depth + kHashSize);
+    std::vector<uint32_t> batch(opt.proofs);
+    merkle::MultiProof multi;
     uint64_t checksum = 0;
-    uint64_t total = static_cast<uint64_t>(MERKLE_PROOFS) * static_cast<uint64_t>(MERKLE_ITERS);
+    uint64_t proof_hashes = 0;
+    uint64_t verify_hashes = 0;
+    uint64_t total = opt.proofs * opt.iters;
+    uint32_t mask = static_cast<uint32_t>(opt.leaves - 1);
 
-    for (uint32_t iter = 0; iter < MERKLE_ITERS; ++iter) {
+    for (uint64_t iter = 0; iter < opt.iters; ++iter) {
 #if MERKLE_PROGRESS
         const char tag[] = "iter=";
         char pbuf[32];
@@ -170,37 +601,57 @@ int main() {
         pbuf[pidx++] = '\n';
         (void)write(2, pbuf, pidx);
 #endif
-        for (uint32_t i = 0; i < MERKLE_PROOFS; ++i) {
-            uint32_t idx = (i * 2654435761u + iter) & (MERKLE_LEAVES - 1);
-            size_t depth = build_proof(idx, path, 20);
-            bool ok = verify_proof(idx, path, depth);
+        if (opt.multiproof) {
+            // One proof for the whole batch; counted per requested index so
+            // the checksum matches the single-proof path.
+            for (uint64_t i = 0; i < opt.proofs; ++i) {
+                batch[i] = proof_index(i, iter, mask);
+            }
+            merkle::build_multiproof(tree, batch.data(), batch.size(), multi);
+            bool ok = merkle::verify_multiproof(tree.seed, tree.root(), tree.leaves, multi, &verify_hashes);
+            proof_hashes += multi.sibling_count();
+            checksum += ok ? opt.proofs : 0;
+            checksum += opt.proofs * tree.root()[0];
+            continue;
+        }
+        for (uint64_t i = 0; i < opt.proofs; ++i) {
+            uint32_t idx = proof_index(i, iter, mask);
+            size_t depth = merkle::build_proof(tree, idx, path.data(), tree.depth);
+            bool ok = merkle::verify_proof(tree, idx, path.data(), depth);
             checksum += ok ? 1 : 0;
-            checksum += node_ptr(0)[0];
+            checksum += tree.root()[0];
+            proof_hashes += depth;
+            verify_hashes += depth + 1;
         }
     }
 
-    char buf[256];
+    char buf[512];
     size_t pos = 0;
-    const char p1[] = "{\"mode\":\"merkle_baremetal\",\"leaves\":";
-    std::memcpy(buf + pos, p1, sizeof(p1) - 1);
-    pos += sizeof(p1) - 1;
-    pos += u64_to_dec(buf + pos, MERKLE_LEAVES);
-    const char p2[] = ",\"proofs\":";
-    std::memcpy(buf + pos, p2, sizeof(p2) - 1);
-    pos += sizeof(p2) - 1;
-    pos += u64_to_dec(buf + pos, MERKLE_PROOFS);
-    const char p3[] = ",\"iters\":";
-    std::memcpy(buf + pos, p3, sizeof(p3) - 1);
-    pos += sizeof(p3) - 1;
-    pos += u64_to_dec(buf + pos, MERKLE_ITERS);
-    const char p4[] = ",\"total_proofs\":";
-    std::memcpy(buf + pos, p4, sizeof(p4) - 1);
-    pos += sizeof(p4) - 1;
-    pos += u64_to_dec(buf + pos, total);
-    const char p5[] = ",\"checksum\":";
-    std::memcpy(buf + pos, p5, sizeof(p5) - 1);
-    pos += sizeof(p5) - 1;
-    pos += u64_to_dec(buf + pos, checksum);
+    put_str(buf, pos, "{\"mode\":\"merkle_baremetal\",\"leaves\":");
+    put_u64(buf, pos, opt.leaves);
+    put_str(buf, pos, ",\"proofs\":");
+    put_u64(buf, pos, opt.proofs);
+    put_str(buf, pos, ",\"iters\":");
+    put_u64(buf, pos, opt.iters);
+    put_str(buf, pos, ",\"total_proofs\":");
+    put_u64(buf, pos, total);
+    put_str(buf, pos, ",\"checksum\":");
+    put_u64(buf, pos, checksum);
+    put_str(buf, pos, ",\"proof_mode\":\"");
+    put_str(buf, pos, opt.multiproof ? "multi" : "single");
+    put_str(buf, pos, "\",\"proof_hashes\":");
+    put_u64(buf, pos, proof_hashes);
+    put_str(buf, pos, ",\"verify_hashes\":");
+    put_u64(buf, pos, verify_hashes);
+    put_str(buf, pos, ",\"hash_backend\":\"");
+    put_str(buf, pos, merkle::hash_backend().name);
+    put_str(buf, pos, "\",\"threads\":");
+    put_u64(buf, pos, threads);
+    put_str(buf, pos, ",\"huge_pages\":");
+    put_str(buf, pos, tree.storage.huge_pages() ? "true" : "false");
+    put_str(buf, pos, ",\"root\":\"");
+    put_hex(buf, pos, tree.root(), kHashSize);
+    buf[pos++] = '"';
     buf[pos++] = '}';
     buf[pos++] = '\n';
     (void)write(1, buf, pos);
@@ -0,0 +1,98 @@
+#include "multiproof.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "hash_lanes.h"
+
+namespace merkle {
+
+void build_multiproof(const Tree &t, const uint32_t *indices, size_t n, MultiProof &proof) {
+    proof.indices.assign(indices, indices + n);
+    std::sort(proof.indices.begin(), proof.indices.end());
+    proof.indices.erase(std::unique(proof.indices.begin(), proof.indices.end()), proof.indices.end());
+    proof.siblings.clear();
+
+    std::vector<size_t> level(proof.indices.begin(), proof.indices.end());
+    std::vector<size_t> next;
+    next.reserve(level.size());
+    for (size_t width = t.leaves; width > 1; width /= 2) {
+        next.clear();
+        for (size_t i = 0; i < level.size(); ++i) {
+            size_t p = level[i];
+            if ((p & 1) == 0 && i + 1 < level.size() && level[i + 1] == p + 1) {
+                ++i;
+            } else {
+                const uint8_t *sib = t.node(width - 1 + (p ^ 1));
+                proof.siblings.insert(proof.siblings.end(), sib, sib + kHashSize);
+            }
+            next.push_back(p >> 1);
+        }
+        level.swap(next);
+    }
+}
+
+namespace {
+
+bool indices_valid(const std::vector<uint32_t> &idx, size_t leaves) {
+    if (idx.empty() || !is_power_of_two(leaves)) return false;
+    for (size_t i = 0; i < idx.size(); ++i) {
+        if (idx[i] >= leaves || (i > 0 && idx[i] <= idx[i - 1])) return false;
+    }
+    return true;
+}
+
+// cur holds the proven leaf hashes on entry and is consumed as scratch.
+bool fold_levels(const uint8_t root[kHashSize], size_t leaves, const MultiProof &proof,
+                 std::vector<uint8_t> &cur, uint64_t *hashes) {
+    const std::vector<uint32_t> &idx = proof.indices;
+    std::vector<uint8_t> blocks(idx.size() * 2 * kHashSize);
+    uint64_t spent = 0;
+
+    std::vector<size_t> level(idx.begin(), idx.end());
+    const uint8_t *sib = proof.siblings.data();
+    const uint8_t *sib_end = sib + proof.siblings.size();
+    for (size_t width = leaves; width > 1; width /= 2) {
+        size_t m = 0;
+        for (size_t i = 0; i < level.size(); ++i) {
+            size_t p = level[i];
+            uint8_t *block = blocks.data() + m * 2 * kHashSize;
+            const uint8_t *h = cur.data() + i * kHashSize;
+            if ((p & 1) == 0 && i + 1 < level.size() && level[i + 1] == p + 1) {
+                std::memcpy(block, h, 2 * kHashSize);
+                ++i;
+            } else {
+                if (sib == sib_end) return false;
+                std::memcpy(block + (p & 1 ? 0 : kHashSize), sib, kHashSize);
+                std::memcpy(block + (p & 1 ? kHashSize : 0), h, kHashSize);
+                sib += kHashSize;
+            }
+            level[m++] = p >> 1;
+        }
+        level.resize(m);
+        // Levels narrow towards the root; the last ones are often one node.
+        hash_backend_for(m).parents(blocks.data(), m, cur.data());
+        spent += m;
+    }
+    if (hashes) *hashes += spent;
+    return sib == sib_end && std::memcmp(cur.data(), root, kHashSize) == 0;
+}
+} // namespace
+
+bool verify_multiproof(const uint8_t seed[kSeedSize], const uint8_t root[kHashSize], size_t leaves,
+                       const MultiProof &proof, uint64_t *hashes) {
+    if (!indices_valid(proof.indices, leaves)) return false;
+    std::vector<uint8_t> cur(proof.indices.size() * kHashSize);
+    hash_backend_for(proof.indices.size()).leaves_list(seed, proof.indices.data(), proof.indices.size(), cur.data());
+    if (hashes) *hashes += proof.indices.size();
+    return fold_levels(root, leaves, proof, cur, hashes);
+}
+
+bool verify_multiproof_leaves(const uint8_t root[kHashSize], size_t leaves, const MultiProof &proof,
+                              const uint8_t *leaf_hashes, uint64_t *hashes) {
+    if (!indices_valid(proof.indices, leaves)) return false;
+    std::vector<uint8_t> cur(leaf_hashes, leaf_hashes + proof.indices.size() * kHashSize);
+    return fold_levels(root, leaves, proof, cur, hashes);
+}
+
+} // namespace merkle
@@ -0,0 +1,39 @@
+#ifndef MERKLE_MULTIPROOF_H
+#define MERKLE_MULTIPROOF_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "tree.h"
+
+namespace merkle {
+
+// Proof for a set of leaves. Siblings that the verifier can derive from
+// other proven leaves are left out, and every hash appears once. They are
+// stored level by level, bottom-up and left to right, which is exactly the
+// order verify_multiproof consumes them in.
+struct MultiProof {
+    std::vector<uint32_t> indices;  // sorted, unique
+    std::vector<uint8_t> siblings;  // kHashSize bytes each
+
+    size_t sibling_count() const { return siblings.size() / kHashSize; }
+};
+
+// Sorts and deduplicates `indices` (all must be < t.leaves).
+void build_multiproof(const Tree &t, const uint32_t *indices, size_t n, MultiProof &proof);
+
+// Rebuilds each shared ancestor once, hashing a whole level of independent
+// nodes per lane-backend call. `hashes`, when set, receives the number of
+// compressions spent.
+bool verify_multiproof(const uint8_t seed[kSeedSize], const uint8_t root[kHashSize], size_t leaves,
+                       const MultiProof &proof, uint64_t *hashes = nullptr);
+
+// Same, with caller-supplied leaf hashes in proof.indices order (for leaves
+// replaced through update_leaves).
+bool verify_multiproof_leaves(const uint8_t root[kHashSize], size_t leaves, const MultiProof &proof,
+                              const uint8_t *leaf_hashes, uint64_t *hashes = nullptr);
+
+} // namespace merkle
+
+#endif /* MERKLE_MULTIPROOF_H */
@@ -0,0 +1,401 @@
+#include "server.h"
+
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+namespace merkle {
+namespace {
+
+constexpr int kMaxEvents = 64;
+constexpr int kPollMs = 200;
+constexpr size_t kReadChunk = 64 * 1024;
+
+volatile sig_atomic_t g_stop = 0;
+
+void on_stop(int) {
+    g_stop = 1;
+}
+
+uint64_t now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+uint32_t load_le32(const uint8_t *p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+void store_le32(uint8_t *p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+    p[2] = static_cast<uint8_t>(v >> 16);
+    p[3] = static_cast<uint8_t>(v >> 24);
+}
+
+bool fill_addr(const char *path, sockaddr_un &addr) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (std::strlen(path) >= sizeof(addr.sun_path)) return false;
+    std::strcpy(addr.sun_path, path);
+    return true;
+}
+
+struct Conn {
+    int fd = -1;
+    std::vector<uint8_t> in;
+    std::vector<uint8_t> out;
+    size_t out_off = 0;
+    bool want_in = true;
+    bool want_out = false;
+    bool closing = false;  // flush what is queued, then close
+};
+
+// A request parsed out of a connection's input, with the offset of its
+// reply in that connection's output.
+struct Pending {
+    int fd;
+    size_t out_off;
+};
+
+struct Item {
+    uint32_t idx;
+    uint32_t req;
+    uint32_t slot;
+};
+
+class Server {
+public:
+    Server(const Snapshot &snap, ServerStats &stats) : snap_(snap), stats_(stats) {}
+
+    ~Server() {
+        for (Conn &c : conns_) {
+            if (c.fd >= 0) ::close(c.fd);
+        }
+        if (ep_ >= 0) ::close(ep_);
+        if (listen_fd_ >= 0) ::close(listen_fd_);
+    }
+
+    bool listen_on(const char *path) {
+        sockaddr_un addr;
+        if (!fill_addr(path, addr)) return false;
+        listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd_ < 0) return false;
+        unlink(path);
+        if (bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) return false;
+        if (listen(listen_fd_, SOMAXCONN) != 0) return false;
+        ep_ = epoll_create1(EPOLL_CLOEXEC);
+        if (ep_ < 0) return false;
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = listen_fd_;
+        return epoll_ctl(ep_, EPOLL_CTL_ADD, listen_fd_, &ev) == 0;
+    }
+
+    void run() {
+        epoll_event events[kMaxEvents];
+        while (!g_stop) {
+            int n = epoll_wait(ep_, events, kMaxEvents, kPollMs);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            for (int i = 0; i < n; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == listen_fd_) {
+                    accept_all();
+                    continue;
+                }
+                uint32_t e = events[i].events;
+                // Read before honouring a hang-up: the peer may have sent its
+                // last requests and closed its end.
+                if (e & EPOLLIN) read_all(conns_[fd]);
+                if ((e & EPOLLERR) || ((e & EPOLLHUP) && !(e & EPOLLIN))) {
+                    drop(fd);
+                    continue;
+                }
+                if (e & EPOLLOUT) flush(conns_[fd]);
+            }
+            serve_batch();
+        }
+    }
+
+private:
+    void accept_all() {
+        for (;;) {
+            int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return;
+            if (static_cast<size_t>(fd) >= conns_.size()) conns_.resize(fd + 1);
+            Conn &c = conns_[fd];
+            c = Conn();
+            c.fd = fd;
+            epoll_event ev = {};
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            if (epoll_ctl(ep_, EPOLL_CTL_ADD, fd, &ev) != 0) drop(fd);
+        }
+    }
+
+    void drop(int fd) {
+        Conn &c = conns_[fd];
+        if (c.fd < 0) return;
+        epoll_ctl(ep_, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        c = Conn();
+    }
+
+    void read_all(Conn &c) {
+        for (;;) {
+            size_t have = c.in.size();
+            c.in.resize(have + kReadChunk);
+            ssize_t r = read(c.fd, c.in.data() + have, kReadChunk);
+            c.in.resize(have + (r > 0 ? static_cast<size_t>(r) : 0));
+            if (r > 0) continue;
+            if (r < 0 && errno == EINTR) continue;
+            if (r == 0) c.closing = true;
+            break;
+        }
+        if (std::find(ready_.begin(), ready_.end(), c.fd) == ready_.end()) ready_.push_back(c.fd);
+    }
+
+    void flush(Conn &c) {
+        while (c.out_off < c.out.size()) {
+            ssize_t w = send(c.fd, c.out.data() + c.out_off, c.out.size() - c.out_off, MSG_NOSIGNAL);
+            if (w < 0 && errno == EINTR) continue;
+            if (w < 0 && errno == EAGAIN) break;
+            if (w <= 0) {
+                drop(c.fd);
+                return;
+            }
+            c.out_off += static_cast<size_t>(w);
+        }
+        bool pending = c.out_off < c.out.size();
+        if (!pending) {
+            c.out.clear();
+            c.out_off = 0;
+            if (c.closing) {
+                drop(c.fd);
+                return;
+            }
+        }
+        // A closing peer has already sent EOF; leaving EPOLLIN armed would
+        // wake the loop on every wait until the output drains.
+        bool want_in = !c.closing;
+        if (pending != c.want_out || want_in != c.want_in) {
+            epoll_event ev = {};
+            ev.events = (want_in ? uint32_t(EPOLLIN) : 0u) | (pending ? uint32_t(EPOLLOUT) : 0u);
+            ev.data.fd = c.fd;
+            epoll_ctl(ep_, EPOLL_CTL_MOD, c.fd, &ev);
+            c.want_in = want_in;
+            c.want_out = pending;
+        }
+    }
+
+    void reply_status(Conn &c, uint32_t status) {
+        size_t off = c.out.size();
+        c.out.resize(off + kResponseHeaderSize);
+        store_le32(c.out.data() + off, status);
+        store_le32(c.out.data() + off + 4, static_cast<uint32_t>(snap_.depth()));
+        std::memcpy(c.out.data() + off + 8, snap_.root(), kHashSize);
+    }
+
+    // Parses every complete request in the ready connections, then fills
+    // all of their paths in one pass sorted by leaf index.
+    void serve_batch() {
+        size_t path_bytes = snap_.depth() * kHashSize;
+        pending_.clear();
+        items_.clear();
+        for (int fd : ready_) {
+            Conn &c = conns_[fd];
+            if (c.fd < 0) continue;
+            size_t off = 0;
+            while (c.in.size() - off >= 4) {
+                uint32_t count = load_le32(c.in.data() + off);
+                if (count == 0 || count > kMaxRequestProofs) {
+                    // The stream can't be resynchronised past a bad count.
+                    reply_status(c, kStatusBadRequest);
+                    c.closing = true;
+                    off = c.in.size();
+                    break;
+                }
+                size_t need = 4 + size_t(count) * 4;
+                if (c.in.size() - off < need) break;
+                bool ok = true;
+                for (uint32_t i = 0; i < count && ok; ++i) {
+                    ok = load_le32(c.in.data() + off + 4 + i * 4) < snap_.leaves();
+                }
+                size_t out_off = c.out.size();
+                reply_status(c, ok ? kStatusOk : kStatusBadRequest);
+                if (ok) {
+                    c.out.resize(out_off + kResponseHeaderSize + count * path_bytes);
+                    uint32_t r = static_cast<uint32_t>(pending_.size());
+                    pending_.push_back({fd, out_off + kResponseHeaderSize});
+                    for (uint32_t i = 0; i < count; ++i) {
+                        items_.push_back({load_le32(c.in.data() + off + 4 + i * 4), r, i});
+                    }
+                }
+                off += need;
+            }
+            c.in.erase(c.in.begin(), c.in.begin() + static_cast<std::ptrdiff_t>(off));
+        }
+
+        // Every reply buffer has its final size now, so offsets are stable.
+        std::sort(items_.begin(), items_.end(), [](const Item &a, const Item &b) { return a.idx < b.idx; });
+        for (const Item &it : items_) {
+            const Pending &p = pending_[it.req];
+            snap_.build_proof(it.idx, conns_[p.fd].out.data() + p.out_off + it.slot * path_bytes);
+        }
+
+        if (!pending_.empty()) {
+            stats_.batches += 1;
+            stats_.requests += pending_.size();
+            stats_.proofs += items_.size();
+            if (pending_.size() > stats_.max_batch) stats_.max_batch = pending_.size();
+        }
+        for (int fd : ready_) {
+            if (conns_[fd].fd >= 0) flush(conns_[fd]);
+        }
+        ready_.clear();
+    }
+
+    const Snapshot &snap_;
+    ServerStats &stats_;
+    int listen_fd_ = -1;
+    int ep_ = -1;
+    std::vector<Conn> conns_;
+    std::vector<int> ready_;
+    std::vector<Pending> pending_;
+    std::vector<Item> items_;
+};
+
+bool write_all(int fd, const uint8_t *p, size_t n) {
+    while (n > 0) {
+        ssize_t w = send(fd, p, n, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+    return true;
+}
+
+bool read_all(int fd, uint8_t *p, size_t n) {
+    while (n > 0) {
+        ssize_t r = read(fd, p, n);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        p += r;
+        n -= static_cast<size_t>(r);
+    }
+    return true;
+}
+} // namespace
+
+bool serve(const Snapshot &snap, const char *socket_path, ServerStats &stats) {
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_stop;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    g_stop = 0;
+
+    Server server(snap, stats);
+    if (!server.listen_on(socket_path)) return false;
+    server.run();
+    unlink(socket_path);
+    return true;
+}
+
+bool run_load(const Snapshot &snap, const LoadConfig &cfg, LoadResult &res) {
+    sockaddr_un addr;
+    if (!fill_addr(cfg.socket_path, addr) || cfg.clients == 0 || cfg.batch == 0 || cfg.batch > kMaxRequestProofs) {
+        return false;
+    }
+    size_t depth = snap.depth();
+    size_t reply_size = kResponseHeaderSize + cfg.batch * depth * kHashSize;
+    uint32_t mask = static_cast<uint32_t>(snap.leaves() - 1);
+
+    struct Client {
+        std::vector<uint64_t> latency;
+        uint64_t verified_ok = 0;
+        bool ok = true;
+    };
+    std::vector<Client> clients(cfg.clients);
+    auto worker = [&](unsigned id) {
+        Client &cl = clients[id];
+        cl.latency.reserve(cfg.requests);
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0) {
+            if (fd >= 0) ::close(fd);
+            cl.ok = false;
+            return;
+        }
+        std::vector<uint8_t> req(4 + cfg.batch * 4);
+        std::vector<uint8_t> reply(reply_size);
+        uint8_t leaf[kHashSize];
+        uint64_t state = 0x9e3779b97f4a7c15ull * (id + 1);
+        for (uint64_t r = 0; r < cfg.requests; ++r) {
+            store_le32(req.data(), cfg.batch);
+            for (uint32_t i = 0; i < cfg.batch; ++i) {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                store_le32(req.data() + 4 + i * 4, static_cast<uint32_t>(state) & mask);
+            }
+            uint64_t t0 = now_ns();
+            if (!write_all(fd, req.data(), req.size()) || !read_all(fd, reply.data(), reply.size())) {
+                cl.ok = false;
+                break;
+            }
+            cl.latency.push_back(now_ns() - t0);
+            bool header_ok = load_le32(reply.data()) == kStatusOk && load_le32(reply.data() + 4) == depth &&
+                             std::memcmp(reply.data() + 8, snap.root(), kHashSize) == 0;
+            for (uint32_t i = 0; i < cfg.batch && header_ok; ++i) {
+                uint32_t idx = load_le32(req.data() + 4 + i * 4);
+                hash_leaf(snap.seed(), idx, leaf);
+                const uint8_t *path = reply.data() + kResponseHeaderSize + i * depth * kHashSize;
+                cl.verified_ok += verify_path(snap.root(), idx, leaf, path, depth) ? 1 : 0;
+            }
+        }
+        ::close(fd);
+    };
+
+    uint64_t t0 = now_ns();
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < cfg.clients; ++i) pool.emplace_back(worker, i);
+    worker(0);
+    for (auto &th : pool) th.join();
+    res.elapsed_ns = now_ns() - t0;
+
+    std::vector<uint64_t> all;
+    bool ok = true;
+    for (const Client &cl : clients) {
+        all.insert(all.end(), cl.latency.begin(), cl.latency.end());
+        res.verified_ok += cl.verified_ok;
+        ok = ok && cl.ok;
+    }
+    std::sort(all.begin(), all.end());
+    res.requests = all.size();
+    res.proofs = all.size() * cfg.batch;
+    res.verified = res.proofs;
+    if (!all.empty()) {
+        res.p50_ns = all[(all.size() - 1) * 50 / 100];
+        res.p90_ns = all[(all.size() - 1) * 90 / 100];
+        res.p99_ns = all[(all.size() - 1) * 99 / 100];
+        res.max_ns = all.back();
+    }
+    return ok;
+}
+
+} // namespace merkle
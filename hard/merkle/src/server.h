@@ -0,0 +1,63 @@
+#ifndef MERKLE_SERVER_H
+#define MERKLE_SERVER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "snapshot.h"
+
+namespace merkle {
+
+// Proof protocol over a Unix stream socket; integers are le32 and a client
+// may pipeline requests.
+//
+//   request:  count, then count leaf indices
+//   response: status, depth, root[32], then count * depth sibling hashes,
+//             each path bottom-up in request order
+//
+// A bad request (count of 0 or above kMaxRequestProofs, index out of range)
+// gets status 1 and no paths.
+constexpr uint32_t kMaxRequestProofs = 4096;
+constexpr uint32_t kStatusOk = 0;
+constexpr uint32_t kStatusBadRequest = 1;
+constexpr size_t kResponseHeaderSize = 8 + kHashSize;
+
+struct ServerStats {
+    uint64_t requests = 0;
+    uint64_t proofs = 0;
+    uint64_t batches = 0;    // event-loop rounds that served at least one request
+    uint64_t max_batch = 0;  // most requests served in one round
+};
+
+// Serves proofs from `snap` until SIGINT or SIGTERM. Each epoll round reads
+// every request that is ready on any connection, serves the whole batch in
+// leaf order (neighbouring leaves share band blocks), then flushes replies.
+bool serve(const Snapshot &snap, const char *socket_path, ServerStats &stats);
+
+struct LoadConfig {
+    const char *socket_path = nullptr;
+    unsigned clients = 4;
+    uint64_t requests = 1000;  // per client
+    uint32_t batch = 16;       // indices per request
+};
+
+struct LoadResult {
+    uint64_t requests = 0;
+    uint64_t proofs = 0;
+    uint64_t verified = 0;  // every path of every response is checked
+    uint64_t verified_ok = 0;
+    uint64_t elapsed_ns = 0;
+    uint64_t p50_ns = 0;
+    uint64_t p90_ns = 0;
+    uint64_t p99_ns = 0;
+    uint64_t max_ns = 0;
+};
+
+// Closed-loop load: `clients` threads, each on its own connection, send
+// `requests` requests back to back and time each round trip. Proofs are
+// checked against `snap`'s seed and root.
+bool run_load(const Snapshot &snap, const LoadConfig &cfg, LoadResult &res);
+
+} // namespace merkle
+
+#endif /* MERKLE_SERVER_H */
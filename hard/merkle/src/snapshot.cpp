@@ -0,0 +1,195 @@
+#include "snapshot.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace merkle {
+namespace {
+
+constexpr char kMagic[8] = {'M', 'R', 'K', 'L', 'S', 'N', 'A', 'P'};
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "snapshot header is stored in host order");
+static_assert(sizeof(SnapshotHeader) <= kSnapshotHeaderSize, "header fits its page");
+constexpr uint64_t kBlockSlots = uint64_t(1) << kSnapshotBandHeight;
+static_assert(kBlockSlots * kHashSize == 4096, "a full band block is one page");
+
+constexpr size_t band_count(size_t depth) {
+    return (depth + kSnapshotBandHeight) / kSnapshotBandHeight;
+}
+
+constexpr unsigned top_band_height(size_t depth) {
+    return static_cast<unsigned>(depth + 1 - (band_count(depth) - 1) * kSnapshotBandHeight);
+}
+
+// First slot of band k (k == band_count(depth) gives the total). A short
+// root band is padded out to a whole block so every later band, and with
+// it every full block, starts on a page boundary.
+constexpr uint64_t band_offset_of(size_t depth, size_t k) {
+    uint64_t off = 0;
+    size_t start = 0;
+    for (size_t i = 0; i < k; ++i) {
+        unsigned h = i == 0 ? top_band_height(depth) : kSnapshotBandHeight;
+        uint64_t slots = (uint64_t(1) << start) << h;  // 2^start blocks of 2^h slots
+        off += (slots + kBlockSlots - 1) / kBlockSlots * kBlockSlots;
+        start += h;
+    }
+    return off;
+}
+
+constexpr bool bands_page_aligned(size_t depth) {
+    for (size_t k = 0; k <= band_count(depth); ++k) {
+        if (band_offset_of(depth, k) % kBlockSlots != 0) return false;
+    }
+    return true;
+}
+
+static_assert(bands_page_aligned(0) && bands_page_aligned(6) && bands_page_aligned(10) &&
+                  bands_page_aligned(13) && bands_page_aligned(19) && bands_page_aligned(kMaxDepth),
+              "every band starts on a page");
+static_assert(band_offset_of(10, 1) == kBlockSlots, "1024 leaves: 512 B root band padded to a page");
+
+} // namespace
+
+void SnapshotLayout::init(size_t tree_depth) {
+    depth = tree_depth;
+    size_t bands = band_count(depth);
+    top_height = top_band_height(depth);
+    for (size_t k = 0; k <= bands; ++k) band_offset[k] = band_offset_of(depth, k);
+    slots = band_offset[bands];
+}
+
+uint64_t SnapshotLayout::slot(size_t level, uint64_t pos) const {
+    size_t k;
+    size_t start;
+    unsigned h;
+    if (level < top_height) {
+        k = 0;
+        start = 0;
+        h = top_height;
+    } else {
+        k = 1 + (level - top_height) / kSnapshotBandHeight;
+        start = top_height + (k - 1) * kSnapshotBandHeight;
+        h = kSnapshotBandHeight;
+    }
+    size_t r = level - start;
+    uint64_t block = pos >> r;
+    uint64_t local = (uint64_t(1) << r) | (pos & ((uint64_t(1) << r) - 1));
+    return band_offset[k] + (block << h) + local;
+}
+
+bool write_snapshot(const Tree &t, const char *path) {
+    SnapshotLayout layout;
+    layout.init(t.depth);
+
+    SnapshotHeader hdr = {};
+    std::memcpy(hdr.magic, kMagic, sizeof(kMagic));
+    hdr.version = kSnapshotVersion;
+    hdr.band_height = kSnapshotBandHeight;
+    hdr.leaves = t.leaves;
+    hdr.depth = static_cast<uint32_t>(t.depth);
+    hdr.node_offset = kSnapshotHeaderSize;
+    hdr.node_bytes = layout.slots * kHashSize;
+    std::memcpy(hdr.seed, t.seed, kSeedSize);
+    std::memcpy(hdr.root, t.root(), kHashSize);
+
+    std::string tmp = std::string(path) + ".tmp";
+    int fd = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    size_t total = kSnapshotHeaderSize + hdr.node_bytes;
+    void *p = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(total)) == 0) {
+        p = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (p == MAP_FAILED) {
+        ::close(fd);
+        unlink(tmp.c_str());
+        return false;
+    }
+    uint8_t *out = static_cast<uint8_t *>(p);
+    std::memcpy(out, &hdr, sizeof(hdr));
+    uint8_t *nodes = out + kSnapshotHeaderSize;
+    // Heap order keeps the reads sequential; consecutive positions of a
+    // level fill one block's run before moving to the next block.
+    for (size_t level = 0, width = 1; level <= t.depth; ++level, width *= 2) {
+        for (size_t pos = 0; pos < width; ++pos) {
+            std::memcpy(nodes + layout.slot(level, pos) * kHashSize, t.node(width - 1 + pos), kHashSize);
+        }
+    }
+    bool ok = msync(p, total, MS_SYNC) == 0;
+    munmap(p, total);
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || std::rename(tmp.c_str(), path) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+Snapshot::~Snapshot() {
+    close();
+}
+
+bool Snapshot::open(const char *path) {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || static_cast<size_t>(sb.st_size) < kSnapshotHeaderSize) {
+        ::close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(sb.st_size);
+    void *p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) return false;
+    map_ = static_cast<uint8_t *>(p);
+    map_size_ = size;
+
+    std::memcpy(&header_, map_, sizeof(header_));
+    const SnapshotHeader &h = header_;
+    bool ok = std::memcmp(h.magic, kMagic, sizeof(kMagic)) == 0 && h.version == kSnapshotVersion &&
+              h.band_height == kSnapshotBandHeight && is_power_of_two(h.leaves) && h.leaves <= kMaxLeaves &&
+              h.depth <= kMaxDepth && (uint64_t(1) << h.depth) == h.leaves && h.node_offset == kSnapshotHeaderSize;
+    if (ok) {
+        layout_.init(h.depth);
+        ok = h.node_bytes == layout_.slots * kHashSize && size >= h.node_offset + h.node_bytes;
+    }
+    if (ok) {
+        nodes_ = map_ + h.node_offset;
+        ok = std::memcmp(node(0, 0), h.root, kHashSize) == 0;
+    }
+    if (!ok) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void Snapshot::close() {
+    if (map_) munmap(map_, map_size_);
+    map_ = nullptr;
+    map_size_ = 0;
+    nodes_ = nullptr;
+    header_ = {};
+}
+
+const uint8_t *Snapshot::node(size_t level, uint64_t pos) const {
+    return nodes_ + layout_.slot(level, pos) * kHashSize;
+}
+
+size_t Snapshot::build_proof(uint32_t leaf_idx, uint8_t *path) const {
+    uint64_t pos = leaf_idx;
+    for (size_t h = 0; h < header_.depth; ++h) {
+        std::memcpy(path + h * kHashSize, node(header_.depth - h, pos ^ 1), kHashSize);
+        pos >>= 1;
+    }
+    return header_.depth;
+}
+
+} // namespace merkle
@@ -0,0 +1,86 @@
+#ifndef MERKLE_SNAPSHOT_H
+#define MERKLE_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "tree.h"
+
+namespace merkle {
+
+// On-disk tree, mapped read-only so loading costs one mmap and no hashing.
+//
+//   [0, 4096)  SnapshotHeader, zero padded
+//   [4096, ..) node slots, kHashSize bytes each
+//
+// Nodes are grouped into bands of kSnapshotBandHeight levels counted up from
+// the leaves (the band holding the root may be shorter and is padded to a
+// whole page). Every subtree of a band is one block: its nodes in heap order
+// at slots 1..2^h-1 and slot 0 unused. A full band block is exactly one
+// page-aligned 4 KiB page, so a proof touches about depth/7 pages instead
+// of one page per level near the leaves.
+// Integers are little-endian.
+constexpr uint32_t kSnapshotVersion = 2;
+constexpr unsigned kSnapshotBandHeight = 7;
+constexpr size_t kSnapshotHeaderSize = 4096;
+
+struct SnapshotHeader {
+    char magic[8];          // "MRKLSNAP"
+    uint32_t version;       // kSnapshotVersion
+    uint32_t band_height;   // kSnapshotBandHeight
+    uint64_t leaves;
+    uint32_t depth;
+    uint32_t reserved;
+    uint64_t node_offset;   // kSnapshotHeaderSize
+    uint64_t node_bytes;
+    uint8_t seed[kSeedSize];
+    uint8_t root[kHashSize];
+};
+
+// Slot arithmetic of the banded layout for a tree of `depth`.
+struct SnapshotLayout {
+    size_t depth = 0;
+    unsigned top_height = 1;                   // levels in the root band
+    uint64_t band_offset[kMaxDepth + 2] = {};  // first slot of each band
+    uint64_t slots = 0;
+
+    void init(size_t tree_depth);
+    uint64_t slot(size_t level, uint64_t pos) const;
+};
+
+// Writes `t` (built) to `path`, replacing it atomically via a temp file.
+bool write_snapshot(const Tree &t, const char *path);
+
+class Snapshot {
+public:
+    Snapshot() = default;
+    ~Snapshot();
+    Snapshot(const Snapshot &) = delete;
+    Snapshot &operator=(const Snapshot &) = delete;
+
+    // Maps `path` and checks the header, file size and stored root slot.
+    bool open(const char *path);
+    void close();
+
+    size_t leaves() const { return static_cast<size_t>(header_.leaves); }
+    size_t depth() const { return header_.depth; }
+    const uint8_t *seed() const { return header_.seed; }
+    const uint8_t *root() const { return header_.root; }
+
+    // Node at `level` (0 = root, depth() = leaves) and position `pos`.
+    const uint8_t *node(size_t level, uint64_t pos) const;
+
+    // Same path as build_proof(): depth() siblings, bottom-up.
+    size_t build_proof(uint32_t leaf_idx, uint8_t *path) const;
+
+private:
+    SnapshotHeader header_ = {};
+    uint8_t *map_ = nullptr;
+    size_t map_size_ = 0;
+    const uint8_t *nodes_ = nullptr;
+    SnapshotLayout layout_;
+};
+
+} // namespace merkle
+
+#endif /* MERKLE_SNAPSHOT_H */
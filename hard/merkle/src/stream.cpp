@@ -0,0 +1,332 @@
+#include "stream.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include "blake3.h"
+#include "hash_lanes.h"
+
+namespace merkle {
+namespace {
+
+// Leaves reduced per lane-backend block; the level buffers stay in L2.
+constexpr size_t kStreamBlock = 4096;
+constexpr unsigned kStreamBlockHeight = 12;
+static_assert(size_t(1) << kStreamBlockHeight == kStreamBlock, "block height");
+// Input consumed per window: enough to amortise worker start-up, small
+// enough that the leaf hashes of a window of tiny records stay bounded.
+constexpr size_t kWindowBytes = size_t(16) << 20;
+constexpr size_t kMaxWindowLeaves = 64 * kStreamBlock;
+
+size_t window_leaves(size_t record_size) {
+    size_t n = kWindowBytes / record_size;
+    if (n > kMaxWindowLeaves) n = kMaxWindowLeaves;
+    if (n >= kStreamBlock) n -= n % kStreamBlock;
+    return n ? n : 1;
+}
+
+constexpr char kLeafContext[] = "merkle stream leaf v1";
+
+const uint8_t *leaf_key() {
+    static const struct Key {
+        uint8_t bytes[BLAKE3_KEY_LEN];
+        Key() {
+            blake3_hasher h;
+            blake3_hasher_init_derive_key(&h, kLeafContext);
+            blake3_hasher_finalize(&h, bytes, sizeof(bytes));
+        }
+    } key;
+    return key.bytes;
+}
+
+// Hashes the records of one window at a time, split over workers that are
+// started once per stream and parked on a condition variable in between.
+class RecordHasher {
+public:
+    explicit RecordHasher(unsigned threads) : threads_(threads) {
+        for (unsigned t = 1; t < threads_; ++t) pool_.emplace_back(&RecordHasher::worker, this, t);
+    }
+
+    ~RecordHasher() {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            quit_ = true;
+        }
+        wake_.notify_all();
+        for (auto &th : pool_) th.join();
+    }
+
+    RecordHasher(const RecordHasher &) = delete;
+    RecordHasher &operator=(const RecordHasher &) = delete;
+
+    // out[i] = leaf hash of data[i * record_size ..] for the records in [data, data + len).
+    void run(const uint8_t *data, size_t len, size_t record_size, uint8_t *out) {
+        size_t n = (len + record_size - 1) / record_size;
+        if (pool_.empty() || n < 2 * threads_) {
+            hash_range(data, len, record_size, out, 0, n);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            job_ = {data, len, record_size, out};
+            pending_ = static_cast<unsigned>(pool_.size());
+            ++generation_;
+        }
+        wake_.notify_all();
+        run_slice(job_, 0);
+        std::unique_lock<std::mutex> lock(mu_);
+        done_.wait(lock, [this] { return pending_ == 0; });
+    }
+
+private:
+    struct Job {
+        const uint8_t *data;
+        size_t len;
+        size_t record_size;
+        uint8_t *out;
+    };
+
+    void hash_range(const uint8_t *data, size_t len, size_t record_size, uint8_t *out, size_t first,
+                    size_t last) const {
+        for (size_t i = first; i < last; ++i) {
+            size_t off = i * record_size;
+            size_t sz = len - off < record_size ? len - off : record_size;
+            hash_record(data + off, sz, out + i * kHashSize);
+        }
+    }
+
+    void run_slice(const Job &job, unsigned t) const {
+        size_t n = (job.len + job.record_size - 1) / job.record_size;
+        size_t per = (n + threads_ - 1) / threads_;
+        size_t first = std::min(n, t * per);
+        size_t last = std::min(n, first + per);
+        hash_range(job.data, job.len, job.record_size, job.out, first, last);
+    }
+
+    void worker(unsigned t) {
+        uint64_t seen = 0;
+        for (;;) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mu_);
+                wake_.wait(lock, [&] { return quit_ || generation_ != seen; });
+                if (quit_) return;
+                seen = generation_;
+                job = job_;
+            }
+            run_slice(job, t);
+            std::lock_guard<std::mutex> lock(mu_);
+            if (--pending_ == 0) done_.notify_one();
+        }
+    }
+
+    unsigned threads_;
+    std::vector<std::thread> pool_;
+    std::mutex mu_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    Job job_ = {};
+    uint64_t generation_ = 0;
+    unsigned pending_ = 0;
+    bool quit_ = false;
+};
+
+bool stream_mapped(int fd, size_t size, size_t record_size, RecordHasher &hasher, StreamTree &st) {
+    void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) return false;
+    const uint8_t *data = static_cast<const uint8_t *>(p);
+    (void)madvise(p, size, MADV_SEQUENTIAL);
+
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t win = window_leaves(record_size) * record_size;
+    std::vector<uint8_t> hashes(window_leaves(record_size) * kHashSize);
+    size_t dropped = 0;
+    bool ok = true;
+    for (size_t off = 0; off < size && ok; off += win) {
+        size_t len = size - off < win ? size - off : win;
+        hasher.run(data + off, len, record_size, hashes.data());
+        ok = st.append(hashes.data(), (len + record_size - 1) / record_size);
+        // Unmap what has been hashed so resident memory stays at one window.
+        size_t done = (off + len) / page * page;
+        if (done > dropped) {
+            (void)madvise(const_cast<uint8_t *>(data) + dropped, done - dropped, MADV_DONTNEED);
+            dropped = done;
+        }
+    }
+    munmap(p, size);
+    return ok;
+}
+
+bool stream_read(int fd, size_t record_size, RecordHasher &hasher, StreamTree &st, uint64_t &bytes) {
+    size_t cap = window_leaves(record_size) * record_size;
+    std::vector<uint8_t> buf(cap);
+    std::vector<uint8_t> hashes(window_leaves(record_size) * kHashSize);
+    for (;;) {
+        // Fill the whole window so records never straddle two reads; only
+        // the final record of the input can come out short.
+        size_t len = 0;
+        while (len < cap) {
+            ssize_t r = read(fd, buf.data() + len, cap - len);
+            if (r < 0 && errno == EINTR) continue;
+            if (r < 0) return false;
+            if (r == 0) break;
+            len += static_cast<size_t>(r);
+        }
+        if (len == 0) return true;
+        hasher.run(buf.data(), len, record_size, hashes.data());
+        if (!st.append(hashes.data(), (len + record_size - 1) / record_size)) return false;
+        bytes += len;
+        if (len < cap) return true;
+    }
+}
+} // namespace
+
+StreamTree::StreamTree(std::vector<uint32_t> targets) : targets_(std::move(targets)) {
+    std::sort(targets_.begin(), targets_.end());
+    targets_.erase(std::unique(targets_.begin(), targets_.end()), targets_.end());
+    leaf_hashes_.assign(targets_.size() * kHashSize, 0);
+    paths_.assign(targets_.size() * kMaxDepth * kHashSize, 0);
+    stack_.reserve(kMaxDepth + 1);
+}
+
+// Hands (height, pos) to every target whose path needs it as a sibling, and
+// to the target itself when it is that target's leaf.
+void StreamTree::emit(unsigned height, uint64_t pos, const uint8_t cv[kHashSize]) {
+    if (targets_.empty()) return;
+    uint64_t lo = (pos ^ 1) << height;
+    uint64_t hi = lo + (uint64_t(1) << height);
+    auto it = std::lower_bound(targets_.begin(), targets_.end(), lo);
+    for (; it != targets_.end() && *it < hi; ++it) {
+        size_t i = static_cast<size_t>(it - targets_.begin());
+        std::memcpy(paths_.data() + (i * kMaxDepth + height) * kHashSize, cv, kHashSize);
+    }
+    if (height == 0 && std::binary_search(targets_.begin(), targets_.end(), pos)) {
+        size_t i = static_cast<size_t>(std::lower_bound(targets_.begin(), targets_.end(), pos) - targets_.begin());
+        std::memcpy(leaf_hashes_.data() + i * kHashSize, cv, kHashSize);
+    }
+}
+
+void StreamTree::push(const uint8_t cv[kHashSize], unsigned height, uint64_t pos) {
+    emit(height, pos, cv);
+    Entry e;
+    std::memcpy(e.cv, cv, kHashSize);
+    e.height = height;
+    e.pos = pos;
+    stack_.push_back(e);
+    while (stack_.size() >= 2 && stack_[stack_.size() - 2].height == stack_.back().height) {
+        Entry &left = stack_[stack_.size() - 2];
+        const Entry &right = stack_.back();
+        hash_node(left.cv, right.cv, left.cv);
+        ++node_hashes_;
+        left.height += 1;
+        left.pos /= 2;
+        stack_.pop_back();
+        emit(left.height, left.pos, left.cv);
+    }
+}
+
+void StreamTree::append_block(const uint8_t *leaf_hashes) {
+    const HashBackend &hb = hash_backend();
+    scratch_.resize(kStreamBlock * kHashSize);
+    uint8_t *bufs[2] = {scratch_.data(), scratch_.data() + kStreamBlock / 2 * kHashSize};
+    uint64_t base = leaves_;
+    auto first = std::lower_bound(targets_.begin(), targets_.end(), base);
+    auto last = std::lower_bound(first, targets_.end(), base + kStreamBlock);
+
+    const uint8_t *cur = leaf_hashes;
+    size_t width = kStreamBlock;
+    for (unsigned h = 0; h < kStreamBlockHeight; ++h) {
+        // Siblings inside the block only matter to targets inside it.
+        for (auto it = first; it != last; ++it) {
+            size_t i = static_cast<size_t>(it - targets_.begin());
+            size_t local = static_cast<size_t>((*it - base) >> h);
+            if (h == 0) std::memcpy(leaf_hashes_.data() + i * kHashSize, cur + local * kHashSize, kHashSize);
+            std::memcpy(paths_.data() + (i * kMaxDepth + h) * kHashSize, cur + (local ^ 1) * kHashSize,
+                        kHashSize);
+        }
+        uint8_t *next = bufs[h & 1];
+        hb.parents(cur, width / 2, next);
+        node_hashes_ += width / 2;
+        cur = next;
+        width /= 2;
+    }
+    leaves_ += kStreamBlock;
+    push(cur, kStreamBlockHeight, base >> kStreamBlockHeight);
+}
+
+bool StreamTree::append(const uint8_t *leaf_hashes, size_t n) {
+    if (n > kMaxLeaves - leaves_) return false;
+    while (n > 0) {
+        if (leaves_ % kStreamBlock == 0 && n >= kStreamBlock) {
+            append_block(leaf_hashes);
+            leaf_hashes += kStreamBlock * kHashSize;
+            n -= kStreamBlock;
+        } else {
+            push(leaf_hashes, 0, leaves_);
+            ++leaves_;
+            leaf_hashes += kHashSize;
+            --n;
+        }
+    }
+    return true;
+}
+
+bool StreamTree::finish() {
+    if (leaves_ == 0) return false;
+    if (!targets_.empty() && targets_.back() >= leaves_) return false;
+    depth_ = 0;
+    while ((uint64_t(1) << depth_) < leaves_) ++depth_;
+
+    // The stack's heights strictly decrease and its top is always a left
+    // child, so pairing the top with an all-padding subtree of its height
+    // and merging again folds it into the root in O(log N) hashes.
+    uint8_t zero[kHashSize] = {};
+    unsigned zero_height = 0;
+    while (stack_.size() > 1 || stack_.back().height < depth_) {
+        const Entry &top = stack_.back();
+        while (zero_height < top.height) {
+            hash_node(zero, zero, zero);
+            ++node_hashes_;
+            ++zero_height;
+        }
+        Entry e = top;
+        stack_.pop_back();
+        emit(e.height, e.pos + 1, zero);
+        uint8_t parent[kHashSize];
+        hash_node(e.cv, zero, parent);
+        ++node_hashes_;
+        push(parent, e.height + 1, e.pos / 2);
+    }
+    std::memcpy(root_, stack_.back().cv, kHashSize);
+    return true;
+}
+
+void hash_record(const uint8_t *data, size_t len, uint8_t out[kHashSize]) {
+    blake3_hasher h;
+    blake3_hasher_init_keyed(&h, leaf_key());
+    blake3_hasher_update(&h, data, len);
+    blake3_hasher_finalize(&h, out, kHashSize);
+}
+
+bool stream_records(int fd, size_t record_size, unsigned threads, StreamTree &st, StreamStats &stats) {
+    if (record_size == 0) return false;
+    RecordHasher hasher(resolve_threads(threads));
+    struct stat sb;
+    if (fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode) && sb.st_size > 0) {
+        stats.mapped = true;
+        stats.bytes = static_cast<uint64_t>(sb.st_size);
+        return stream_mapped(fd, static_cast<size_t>(sb.st_size), record_size, hasher, st);
+    }
+    stats.mapped = false;
+    return stream_read(fd, record_size, hasher, st, stats.bytes);
+}
+
+} // namespace merkle
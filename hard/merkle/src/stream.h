@@ -0,0 +1,88 @@
+#ifndef MERKLE_STREAM_H
+#define MERKLE_STREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "tree.h"
+
+namespace merkle {
+
+// Merkle root over leaf hashes that arrive in order, keeping only a stack of
+// completed subtree roots (at most one per height, as in blake3_hasher's
+// lazy chaining-value merge) instead of the 2N-1 node array. finish() pads
+// to the next power of two with all-zero leaf hashes, so the root and proofs
+// match a Tree built over the same padded leaves and check with verify_path.
+//
+// Proofs for a preselected set of leaves are collected in the same pass:
+// every node is offered to the targets whose path it lies on as it goes by.
+class StreamTree {
+public:
+    // `targets` are sorted and deduplicated here.
+    explicit StreamTree(std::vector<uint32_t> targets = {});
+
+    // Appends n consecutive leaf hashes. Runs that start on a block boundary
+    // are reduced a whole level per lane-backend call. False past kMaxLeaves.
+    bool append(const uint8_t *leaf_hashes, size_t n);
+
+    // Pads and merges the stack into the root. False if there were no leaves
+    // or a target lies past the last real leaf.
+    bool finish();
+
+    uint64_t leaves() const { return leaves_; }
+    uint64_t padded_leaves() const { return uint64_t(1) << depth_; }
+    size_t depth() const { return depth_; }
+    const uint8_t *root() const { return root_; }
+    uint64_t node_hashes() const { return node_hashes_; }
+
+    const std::vector<uint32_t> &targets() const { return targets_; }
+    // Leaf hash and depth() sibling hashes (bottom-up) of targets()[i].
+    const uint8_t *leaf(size_t i) const { return leaf_hashes_.data() + i * kHashSize; }
+    const uint8_t *path(size_t i) const { return paths_.data() + i * kMaxDepth * kHashSize; }
+
+private:
+    struct Entry {
+        uint8_t cv[kHashSize];
+        unsigned height;
+        uint64_t pos;  // position within its level
+    };
+
+    void push(const uint8_t cv[kHashSize], unsigned height, uint64_t pos);
+    void emit(unsigned height, uint64_t pos, const uint8_t cv[kHashSize]);
+    void append_block(const uint8_t *leaf_hashes);
+
+    std::vector<uint32_t> targets_;
+    std::vector<uint8_t> leaf_hashes_;
+    std::vector<uint8_t> paths_;
+    std::vector<Entry> stack_;
+    std::vector<uint8_t> scratch_;
+    uint64_t leaves_ = 0;
+    uint64_t node_hashes_ = 0;
+    size_t depth_ = 0;
+    uint8_t root_[kHashSize] = {};
+};
+
+struct StreamStats {
+    uint64_t bytes = 0;
+    bool mapped = false;  // mmap'd regular file, else read() from a pipe
+};
+
+// Leaf hash of one record: blake3(record, key=derive_key("merkle stream leaf
+// v1")). Parents are unkeyed blake3(left || right), so a record can never be
+// passed off as a pair of children or the other way round, and these roots
+// differ from a Tree over blake3(record) leaves. Padding leaves are the raw
+// all-zero value, which neither domain produces short of a 2^256 preimage;
+// a proof only counts for index < leaves, so verifiers must check that too.
+void hash_record(const uint8_t *data, size_t len, uint8_t out[kHashSize]);
+
+// Cuts `fd` into record_size-byte records (the last one may be short), hashes
+// each with hash_record() straight out of the mapping or read buffer, and
+// appends them to `st`. Leaf hashing of each window is split over `threads`
+// workers (0 = all cores) that live for the whole stream. Does not call
+// st.finish().
+bool stream_records(int fd, size_t record_size, unsigned threads, StreamTree &st, StreamStats &stats);
+
+} // namespace merkle
+
+#endif /* MERKLE_STREAM_H */
@@ -0,0 +1,252 @@
+#include "tree.h"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "blake3.h"
+#include "hash_lanes.h"
+
+namespace merkle {
+namespace {
+
+constexpr size_t kHugePage = size_t(2) << 20;
+// Leaves per cache block: the block's leaves plus its parents fit in L2, so
+// a worker finishes each block's levels before moving on.
+constexpr size_t kBlockLeaves = 4096;
+// Below this the thread start-up costs more than the hashing.
+constexpr size_t kParallelMinLeaves = size_t(1) << 14;
+// Subtrees per worker, for balance when cores are unevenly loaded.
+constexpr size_t kSubtreesPerThread = 4;
+
+unsigned log2_exact(size_t v) {
+    unsigned n = 0;
+    while (v > 1) {
+        v >>= 1;
+        ++n;
+    }
+    return n;
+}
+
+size_t round_up(size_t v, size_t m) {
+    return (v + m - 1) / m * m;
+}
+
+// Hashes `levels` parent levels above positions [first, first + count) of
+// the level that holds `width` nodes. count must be a power of two.
+void hash_up(const Tree &t, size_t width, size_t first, size_t count, unsigned levels) {
+    const HashBackend &hb = hash_backend();
+    for (unsigned h = 0; h < levels; ++h) {
+        hb.parents(t.node(width - 1 + first), count / 2, t.node(width / 2 - 1 + first / 2));
+        width /= 2;
+        first /= 2;
+        count /= 2;
+    }
+}
+
+// Leaves [first, first + count) (when with_leaves) and every ancestor whose
+// leaves all lie in that range, walked one cache block at a time.
+void build_subtree(const Tree &t, size_t first, size_t count, bool with_leaves) {
+    const HashBackend &hb = hash_backend();
+    size_t block = count < kBlockLeaves ? count : kBlockLeaves;
+    for (size_t b = first; b < first + count; b += block) {
+        if (with_leaves) hb.leaves(t.seed, static_cast<uint32_t>(b), block, t.node(t.leaf_base + b));
+        hash_up(t, t.leaves, b, block, log2_exact(block));
+    }
+    size_t width = t.leaves / block;
+    hash_up(t, width, first / block, count / block, log2_exact(count / block));
+}
+
+void build_levels(Tree &t, unsigned threads, bool with_leaves) {
+    threads = resolve_threads(threads);
+    if (threads == 1 || t.leaves < kParallelMinLeaves) {
+        build_subtree(t, 0, t.leaves, with_leaves);
+        return;
+    }
+
+    size_t subtrees = 1;
+    while (subtrees < size_t(threads) * kSubtreesPerThread && t.leaves / subtrees > kBlockLeaves) {
+        subtrees *= 2;
+    }
+    size_t span = t.leaves / subtrees;
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t s; (s = next.fetch_add(1, std::memory_order_relaxed)) < subtrees;) {
+            build_subtree(t, s * span, span, with_leaves);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads && i < subtrees; ++i) pool.emplace_back(worker);
+    worker();
+    for (auto &th : pool) th.join();
+
+    hash_up(t, subtrees, 0, subtrees, log2_exact(subtrees));
+}
+} // namespace
+
+Arena::~Arena() {
+    release();
+}
+
+bool Arena::allocate(size_t bytes) {
+    release();
+    size_t len = round_up(bytes ? bytes : 1, kHugePage);
+    void *p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    huge_ = p != MAP_FAILED;
+#endif
+    if (p == MAP_FAILED) {
+        p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) return false;
+#ifdef MADV_HUGEPAGE
+        (void)madvise(p, len, MADV_HUGEPAGE);
+#endif
+    }
+    data_ = static_cast<uint8_t *>(p);
+    size_ = len;
+    return true;
+}
+
+void Arena::release() {
+    if (data_) munmap(data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+    huge_ = false;
+}
+
+bool is_power_of_two(size_t v) {
+    return v && ((v & (v - 1)) == 0);
+}
+
+void hash_leaf(const uint8_t seed[kSeedSize], uint32_t idx, uint8_t out[kHashSize]) {
+    blake3_hasher h;
+    blake3_hasher_init(&h);
+    blake3_hasher_update(&h, seed, kSeedSize);
+    uint8_t idx_bytes[4] = {
+        static_cast<uint8_t>(idx & 0xff),
+        static_cast<uint8_t>((idx >> 8) & 0xff),
+        static_cast<uint8_t>((idx >> 16) & 0xff),
+        static_cast<uint8_t>((idx >> 24) & 0xff),
+    };
+    blake3_hasher_update(&h, idx_bytes, sizeof(idx_bytes));
+    blake3_hasher_finalize(&h, out, kHashSize);
+}
+
+void hash_node(const uint8_t *left, const uint8_t *right, uint8_t out[kHashSize]) {
+    blake3_hasher h;
+    blake3_hasher_init(&h);
+    blake3_hasher_update(&h, left, kHashSize);
+    blake3_hasher_update(&h, right, kHashSize);
+    blake3_hasher_finalize(&h, out, kHashSize);
+}
+
+unsigned resolve_threads(unsigned threads) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    return threads ? threads : 1;
+}
+
+bool tree_init(Tree &t, const uint8_t seed[kSeedSize], size_t leaves) {
+    if (!is_power_of_two(leaves) || leaves > kMaxLeaves) return false;
+    if (!t.storage.allocate((2 * leaves - 1) * kHashSize)) return false;
+    t.leaves = leaves;
+    t.leaf_base = leaves - 1;
+    t.depth = log2_exact(leaves);
+    std::memcpy(t.seed, seed, kSeedSize);
+    return true;
+}
+
+void build_tree(Tree &t, unsigned threads) {
+    build_levels(t, threads, true);
+}
+
+void rehash_parents(Tree &t, unsigned threads) {
+    build_levels(t, threads, false);
+}
+
+bool update_leaves(Tree &t, const uint32_t *idx, const uint8_t *leaf_hashes, size_t n, uint64_t *spent) {
+    for (size_t i = 0; i < n; ++i) {
+        if (idx[i] >= t.leaves) return false;
+    }
+    if (n == 0) return true;
+    // Sorting by (leaf, input position) and writing in that order lets the
+    // last duplicate win.
+    std::vector<size_t> order(n);
+    for (size_t i = 0; i < n; ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [idx](size_t a, size_t b) {
+        return idx[a] != idx[b] ? idx[a] < idx[b] : a < b;
+    });
+    std::vector<size_t> level;
+    level.reserve(n);
+    for (size_t i : order) {
+        std::memcpy(t.node(t.leaf_base + idx[i]), leaf_hashes + i * kHashSize, kHashSize);
+        if (level.empty() || level.back() != idx[i]) level.push_back(idx[i]);
+    }
+
+    const HashBackend &hb = hash_backend();
+    std::vector<uint8_t> blocks(level.size() * 2 * kHashSize);
+    std::vector<uint8_t> out(level.size() * kHashSize);
+    uint64_t hashed = 0;
+    for (size_t width = t.leaves; width > 1; width /= 2) {
+        size_t m = 0;
+        for (size_t i = 0; i < level.size(); ++i) {
+            size_t q = level[i] >> 1;
+            if (m > 0 && level[m - 1] == q) continue;
+            std::memcpy(blocks.data() + m * 2 * kHashSize, t.node(width - 1 + 2 * q), 2 * kHashSize);
+            level[m++] = q;
+        }
+        level.resize(m);
+        hb.parents(blocks.data(), m, out.data());
+        for (size_t i = 0; i < m; ++i) {
+            std::memcpy(t.node(width / 2 - 1 + level[i]), out.data() + i * kHashSize, kHashSize);
+        }
+        hashed += m;
+    }
+    if (spent) *spent += hashed;
+    return true;
+}
+
+size_t build_proof(const Tree &t, uint32_t leaf_idx, uint8_t *path, size_t max_path) {
+    size_t node = t.leaf_base + leaf_idx;
+    size_t depth = 0;
+    while (node > 0 && depth + 1 <= max_path) {
+        size_t sibling = (node % 2 == 0) ? node - 1 : node + 1;
+        std::memcpy(path + depth * kHashSize, t.node(sibling), kHashSize);
+        node = (node - 1) / 2;
+        depth++;
+    }
+    return depth;
+}
+
+bool verify_proof(const Tree &t, uint32_t leaf_idx, const uint8_t *path, size_t depth) {
+    uint8_t leaf[kHashSize];
+    hash_leaf(t.seed, leaf_idx, leaf);
+    return verify_path(t.root(), leaf_idx, leaf, path, depth);
+}
+
+bool verify_path(const uint8_t root[kHashSize], uint32_t leaf_idx, const uint8_t leaf_hash[kHashSize],
+                 const uint8_t *path, size_t depth) {
+    uint8_t cur[kHashSize];
+    uint8_t tmp[kHashSize];
+    std::memcpy(cur, leaf_hash, kHashSize);
+
+    // Position parity within the level: even positions are left children.
+    size_t pos = leaf_idx;
+    for (size_t i = 0; i < depth; ++i) {
+        const uint8_t *sib = path + i * kHashSize;
+        if (pos % 2 == 0) {
+            hash_node(cur, sib, tmp);
+        } else {
+            hash_node(sib, cur, tmp);
+        }
+        std::memcpy(cur, tmp, kHashSize);
+        pos /= 2;
+    }
+    return std::memcmp(cur, root, kHashSize) == 0;
+}
+
+} // namespace merkle
@@ -0,0 +1,82 @@
+#ifndef MERKLE_TREE_H
+#define MERKLE_TREE_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace merkle {
+
+constexpr size_t kHashSize = 32;
+constexpr size_t kSeedSize = 32;
+// Leaf indices are hashed as le32, and 2^31 leaves already need 128 GiB.
+constexpr size_t kMaxLeaves = size_t(1) << 31;
+constexpr size_t kMaxDepth = 31;
+
+// Anonymous mmap-backed storage. Tries explicit huge pages first and falls
+// back to regular pages with transparent huge pages requested.
+class Arena {
+public:
+    Arena() = default;
+    ~Arena();
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    bool allocate(size_t bytes);
+    void release();
+
+    uint8_t *data() const { return data_; }
+    size_t size() const { return size_; }
+    bool huge_pages() const { return huge_; }
+
+private:
+    uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+    bool huge_ = false;
+};
+
+// Complete binary tree in heap order: node 0 is the root, children of i are
+// 2i+1 and 2i+2, and the leaves occupy [leaves-1, 2*leaves-2].
+struct Tree {
+    size_t leaves = 0;
+    size_t leaf_base = 0;
+    size_t depth = 0;
+    uint8_t seed[kSeedSize] = {};
+    Arena storage;
+
+    uint8_t *node(size_t idx) const { return storage.data() + idx * kHashSize; }
+    const uint8_t *root() const { return node(0); }
+};
+
+bool is_power_of_two(size_t v);
+
+void hash_leaf(const uint8_t seed[kSeedSize], uint32_t idx, uint8_t out[kHashSize]);
+void hash_node(const uint8_t *left, const uint8_t *right, uint8_t out[kHashSize]);
+
+// Allocates storage for a power-of-two leaf count; false on bad size or OOM.
+bool tree_init(Tree &t, const uint8_t seed[kSeedSize], size_t leaves);
+
+// Builds every node. Large trees are split into equal subtrees hashed by
+// `threads` workers (0 = all cores); the top levels are merged serially.
+void build_tree(Tree &t, unsigned threads);
+
+// Recomputes every parent from the current leaf hashes (no leaf rehash).
+void rehash_parents(Tree &t, unsigned threads);
+
+// Replaces leaf_hashes[i] at leaf idx[i] (the last one wins on duplicates)
+// and rehashes only their ancestors, one batched lane call per level, so
+// each shared parent is hashed once. Adds the compressions spent to *spent
+// when given. False (and nothing written) if any idx[i] >= t.leaves.
+bool update_leaves(Tree &t, const uint32_t *idx, const uint8_t *leaf_hashes, size_t n, uint64_t *spent = nullptr);
+
+size_t build_proof(const Tree &t, uint32_t leaf_idx, uint8_t *path, size_t max_path);
+// Checks the synthetic leaf hash_leaf(seed, idx) against the tree's root.
+bool verify_proof(const Tree &t, uint32_t leaf_idx, const uint8_t *path, size_t depth);
+// Checks an arbitrary leaf hash, e.g. one written by update_leaves.
+bool verify_path(const uint8_t root[kHashSize], uint32_t leaf_idx, const uint8_t leaf_hash[kHashSize],
+                 const uint8_t *path, size_t depth);
+
+unsigned resolve_threads(unsigned threads);
+
+} // namespace merkle
+
+#endif /* MERKLE_TREE_H */
@@ -16,8 +16,13 @@ HASH_ALGO=${HASH_ALGO:-blake3}
 NONCE_START=${NONCE_START:-}
 SUBMIT=${SUBMIT:-0}
 TT_DEVICE_ID=${TT_DEVICE_ID:-}
+MINER_ENGINE=${MINER_ENGINE:-native}
+MINER_THREADS=${MINER_THREADS:-0}
+LOCAL_VERIFY=${LOCAL_VERIFY:-1}
+REMOTE_VALIDATE=${REMOTE_VALIDATE:-1}
 
 export RPC_URL TARGET_BITS PRINT_EVERY MAX_ITERS HASH_ALGO NONCE_START SUBMIT TT_DEVICE_ID
+export MINER_ENGINE MINER_THREADS LOCAL_VERIFY REMOTE_VALIDATE
 export MINER=1
 
 exec "${ROOT_DIR}/run_riscv_validate.sh"
@@ -22,15 +22,19 @@ PRINT_EVERY=${PRINT_EVERY:-1}
 HASH_ALGO=${HASH_ALGO:-blake3}
 NONCE_START=${NONCE_START:-}
 TT_DEVICE_ID=${TT_DEVICE_ID:-}
+MINER_ENGINE=${MINER_ENGINE:-native}
+MINER_THREADS=${MINER_THREADS:-0}
+LOCAL_VERIFY=${LOCAL_VERIFY:-1}
+REMOTE_VALIDATE=${REMOTE_VALIDATE:-1}
 
 MATMUL_DIR="${ROOT_DIR}/hard/matmul"
 SCRIPT_DIR="${MATMUL_DIR}/scripts"
 BUILD_DIR="${MATMUL_DIR}/build_ttnn"
 SOLUTION_OUT="${BUILD_DIR}/solution.bin"
+NATIVE_MINER="${MATMUL_DIR}/upow_miner"
+NATIVE_VERIFY="${MATMUL_DIR}/upow_verify"
 SOLUTION_HEX=""
 FOUND=0
-SEED_PREFIX_HEX=""
-NONCE_HI_HEX=""
 NONCE_VAL=0
 
 if [[ -z "${SEED_BIN}" ]]; then
@@ -41,34 +45,6 @@ log() {
   echo ">> $*"
 }
 
-now_ns() {
-  local val=""
-  if command -v python3 >/dev/null 2>&1; then
-    val=$(python3 - <<'PY'
-import time
-print(time.time_ns())
-PY
-)
-  elif command -v python >/dev/null 2>&1; then
-    val=$(python - <<'PY'
-import time
-print(int(time.time() * 1_000_000_000))
-PY
-)
-  elif command -v perl >/dev/null 2>&1; then
-    val=$(perl -MTime::HiRes -e 'printf "%.0f", Time::HiRes::time()*1e9')
-  elif [[ -r /proc/uptime ]]; then
-    val=$(awk '{printf "%.0f", $1*1000000000}' /proc/uptime)
-  elif command -v date >/dev/null 2>&1; then
-    val=$(date +%s%N 2>/dev/null | tr -cd '0-9')
-  fi
-  if [[ -z "${val}" ]]; then
-    echo 0
-  else
-    echo "${val}"
-  fi
-}
-
 need_cmd() {
   if ! command -v "$1" >/dev/null 2>&1; then
     echo "Missing command: $1" >&2
@@ -138,8 +114,6 @@ init_nonce_state() {
     echo "Seed hex length ${#SEED_HEX} is invalid (expected 480)." >&2
     exit 1
   fi
-  SEED_PREFIX_HEX="${SEED_HEX:0:456}"
-  NONCE_HI_HEX="${SEED_HEX:456:8}"
   local nonce_low_hex="${SEED_HEX:464:16}"
   if [[ -n "${NONCE_START}" ]]; then
     NONCE_VAL="${NONCE_START}"
@@ -154,77 +128,21 @@ PY
   fi
 }
 
-build_seed_hex_for_nonce() {
-  local nonce_hex
-  nonce_hex=$(NONCE_VAL="${NONCE_VAL}" python3 - <<'PY'
-import os
-nonce = int(os.environ.get("NONCE_VAL", "0"))
-print(nonce.to_bytes(8, "little").hex())
-PY
-)
-  echo "${SEED_PREFIX_HEX}${NONCE_HI_HEX}${nonce_hex}"
-}
-
-hash_bits() {
-  local sol_hex="$1"
-  if [[ "${HASH_ALGO}" == "blake3" && -n "${sol_hex}" ]] && command -v node >/dev/null 2>&1; then
-    local bits
-    bits=$(
-      cd "${SCRIPT_DIR}" && SOLUTION_HEX="${sol_hex}" node --input-type=module - <<'NODE'
-import { blake3 } from '@noble/hashes/blake3'
-const hex = process.env.SOLUTION_HEX || ''
-const bytes = Buffer.from(hex, 'hex')
-const digest = blake3(bytes)
-let bits = 0
-for (const b of digest) {
-  if (b === 0) {
-    bits += 8
-  } else {
-    let lead = 0
-    for (let mask = 0x80; mask > 0; mask >>= 1) {
-      if (b & mask) break
-      lead += 1
-    }
-    bits += lead
-    break
-  }
-}
-console.log(bits)
-NODE
-    ) || bits=""
-    if [[ -n "${bits}" ]]; then
-      echo "${bits}"
-      return 0
-    fi
-  fi
-  if command -v python3 >/dev/null 2>&1; then
-    SOLUTION_HEX="${sol_hex}" python3 - <<'PY'
-import os, hashlib
-hex_str = os.environ.get("SOLUTION_HEX", "")
-data = bytes.fromhex(hex_str)
-h = hashlib.sha256(data).digest()
-bits = 0
-for b in h:
-    if b == 0:
-        bits += 8
-        continue
-    bits += 8 - b.bit_length()
-    break
-print(bits)
-PY
-  else
-    echo 0
+build_pyext() {
+  # Optional: ttnn_upow.py falls back to (and warns about) the pure-Python
+  # expander when the extension cannot be built, e.g. without Python headers.
+  if command -v make >/dev/null 2>&1 && make -C "${MATMUL_DIR}" pyext PYTHON=python3 >/dev/null 2>&1; then
+    return 0
   fi
+  log "Could not build the upow_expand extension (make -C hard/matmul pyext); using pure-Python A/B expansion."
 }
 
 run_ttnn() {
-  local seed_hex_override="${1:-}"
   local -a args
-  args=(--print-solution)
+  args=(--print-solution "$@")
   need_cmd python3
-  if [[ -n "${seed_hex_override}" ]]; then
-    args+=(--seed-hex "${seed_hex_override}")
-  elif [[ -n "${SEED_HEX}" ]]; then
+  build_pyext
+  if [[ -n "${SEED_HEX}" ]]; then
     args+=(--seed-hex "${SEED_HEX}")
   else
     args+=(--seed-bin "${SEED_BIN}")
@@ -237,6 +155,9 @@ run_ttnn() {
   output_file=$(mktemp)
   python3 "${SCRIPT_DIR}/ttnn_upow.py" "${args[@]}" 2>&1 | tee "${output_file}"
   SOLUTION_HEX=$(sed -n 's/^solution_hex=//p' "${output_file}" | tail -n 1 | tr -d '\r\n')
+  if grep -q '^FOUND!' "${output_file}"; then
+    FOUND=1
+  fi
   rm -f "${output_file}"
   if [[ -z "${SOLUTION_HEX}" ]]; then
     echo "Failed to capture solution_hex from TTNN output." >&2
@@ -244,6 +165,39 @@ run_ttnn() {
   fi
 }
 
+build_native_miner() {
+  need_cmd make
+  log "Building native miner and verifier (hard/matmul)..."
+  make -C "${MATMUL_DIR}" >/dev/null
+}
+
+run_native_miner() {
+  local -a args
+  args=(--target-bits "${TARGET_BITS}" --max-iters "${MAX_ITERS}" --print-every "${PRINT_EVERY}"
+        --threads "${MINER_THREADS}")
+  if [[ -n "${SEED_HEX}" ]]; then
+    args+=(--seed-hex "${SEED_HEX}")
+  else
+    args+=(--seed-bin "${SEED_BIN}")
+  fi
+  if [[ -n "${NONCE_START}" ]]; then
+    args+=(--nonce-start "${NONCE_START}")
+  fi
+  build_native_miner
+  local output_file
+  output_file=$(mktemp)
+  "${NATIVE_MINER}" "${args[@]}" 2>&1 | tee "${output_file}"
+  SOLUTION_HEX=$(sed -n 's/^solution_hex=//p' "${output_file}" | tail -n 1 | tr -d '\r\n')
+  if grep -q '^FOUND!' "${output_file}"; then
+    FOUND=1
+  fi
+  rm -f "${output_file}"
+  if [[ -z "${SOLUTION_HEX}" ]]; then
+    echo "Failed to capture solution_hex from native miner output." >&2
+    exit 1
+  fi
+}
+
 write_solution_bin() {
   if [[ -z "${SOLUTION_HEX}" ]]; then
     echo "Missing solution hex data." >&2
@@ -270,8 +224,16 @@ PY
   fi
 }
 
+verify_local() {
+  build_native_miner
+  log "Checking solution locally (Freivalds, ${FREIVALDS_ROUNDS:-4} rounds)"
+  if ! "${NATIVE_VERIFY}" "${SOLUTION_OUT}"; then
+    echo "Local Freivalds check rejected ${SOLUTION_OUT}; not sending it." >&2
+    exit 1
+  fi
+}
+
 validate_solution() {
-  need_cmd curl
   if [[ "${MINER}" == "1" && "${TARGET_BITS}" != "0" && "${FOUND}" != "1" ]]; then
     log "Skipping validation (no solution met TARGET_BITS)."
     return 0
@@ -281,6 +243,14 @@ validate_solution() {
     echo "Missing solution file: ${SOLUTION_OUT}" >&2
     exit 1
   fi
+  if [[ "${LOCAL_VERIFY}" == "1" ]]; then
+    verify_local
+  fi
+  if [[ "${REMOTE_VALIDATE}" != "1" ]]; then
+    log "Skipping remote validation (REMOTE_VALIDATE=${REMOTE_VALIDATE})."
+    return 0
+  fi
+  need_cmd curl
   local bytes
   bytes=$(wc -c < "${SOLUTION_OUT}" | tr -d ' ')
   log "Validating solution (${bytes} bytes) at ${VALIDATE_URL}"
@@ -312,38 +282,21 @@ submit_solution() {
 }
 
 ensure_seed
-if [[ "${MINER}" == "1" ]]; then
+if [[ "${MINER}" == "1" && "${MINER_ENGINE}" == "native" && "${HASH_ALGO}" == "blake3" ]]; then
+  run_native_miner
+  validate_solution
+  submit_solution
+elif [[ "${MINER}" == "1" ]]; then
+  # One ttnn_upow.py process walks every nonce, keeping the device open and
+  # the padded A/B buffers allocated across nonces.
   init_nonce_state
-  attempts=0
-  best_bits=0
-  start_ns=$(now_ns)
-  while true; do
-    attempts=$((attempts + 1))
-    seed_hex_iter=$(build_seed_hex_for_nonce)
-    run_ttnn "${seed_hex_iter}"
-    bits=$(hash_bits "${SOLUTION_HEX}")
-    if [[ -z "${bits}" ]]; then
-      bits=0
-    fi
-    if [[ "${bits}" -gt "${best_bits}" ]]; then
-      best_bits="${bits}"
-    fi
-    now_ns_val=$(now_ns)
-    elapsed_sec=$(awk -v s="${start_ns}" -v e="${now_ns_val}" 'BEGIN{printf "%.3f", (e-s)/1000000000.0}')
-    rate=$(awk -v n="${attempts}" -v s="${elapsed_sec}" 'BEGIN{if(s==0){printf "0.000"} else {printf "%.3f", n/s}}')
-    if (( attempts % PRINT_EVERY == 0 )); then
-      echo "hashes=${attempts} rate_h/s=${rate} best=${best_bits} bits=${bits} nonce=${NONCE_VAL}"
-    fi
-    if [[ "${TARGET_BITS}" != "0" && "${bits}" -ge "${TARGET_BITS}" ]]; then
-      FOUND=1
-      echo "FOUND! nonce=${NONCE_VAL} bits=${bits} rate_avg_h/s=${rate}"
-      break
-    fi
-    if [[ "${MAX_ITERS}" != "0" && "${attempts}" -ge "${MAX_ITERS}" ]]; then
-      break
-    fi
-    NONCE_VAL=$((NONCE_VAL + 1))
-  done
+  nonces="${MAX_ITERS}"
+  if [[ "${nonces}" == "0" && "${TARGET_BITS}" == "0" ]]; then
+    echo "MAX_ITERS=0 needs TARGET_BITS to stop the TTNN miner." >&2
+    exit 1
+  fi
+  run_ttnn --nonce-start "${NONCE_VAL}" --nonces "${nonces}" --target-bits "${TARGET_BITS}" \
+    --print-every "${PRINT_EVERY}" --hash-algo "${HASH_ALGO}"
   validate_solution
   submit_solution
 else